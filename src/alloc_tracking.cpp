@@ -0,0 +1,184 @@
+#include "alloc_tracking.h"
+
+#if defined(KUROMASU_ALLOC_TRACKING)
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#ifdef TRACY_ENABLE
+#include "tracy/Tracy.hpp"
+#define track_alloc(ptr, size) TracyAlloc(ptr, size)
+#define track_free(ptr) TracyFree(ptr)
+#define track_alloc_n(ptr, size, pool) TracyAllocN(ptr, size, pool)
+#define track_free_n(ptr, pool) TracyFreeN(ptr, pool)
+#else
+#define track_alloc(ptr, size)
+#define track_free(ptr)
+#define track_alloc_n(ptr, size, pool)
+#define track_free_n(ptr, pool)
+#endif
+
+static std::atomic<uint64_t> g_total_allocs = 0;
+static std::atomic<uint64_t> g_total_frees = 0;
+static std::atomic<uint64_t> g_total_bytes = 0;
+
+// plain integers on purpose, these must be usable before any constructor has run
+static thread_local uint64_t t_allocs = 0;
+static thread_local uint64_t t_frees = 0;
+static thread_local uint64_t t_bytes = 0;
+
+static alloc_counters g_frame_start;
+static alloc_counters g_last_frame;
+
+static void count_alloc(size_t size) {
+    t_allocs++;
+    t_bytes += size;
+    g_total_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_total_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void count_free() {
+    t_frees++;
+    g_total_frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+alloc_counters alloc_tracking_thread() { return {t_allocs, t_frees, t_bytes}; }
+
+alloc_counters alloc_tracking_total() {
+    return {g_total_allocs.load(std::memory_order_relaxed),
+        g_total_frees.load(std::memory_order_relaxed),
+        g_total_bytes.load(std::memory_order_relaxed)};
+}
+
+void alloc_tracking_frame() {
+    alloc_counters now = alloc_tracking_thread();
+    g_last_frame = {now.allocs - g_frame_start.allocs,
+        now.frees - g_frame_start.frees,
+        now.bytes - g_frame_start.bytes};
+    g_frame_start = now;
+}
+
+alloc_counters alloc_tracking_last_frame() { return g_last_frame; }
+
+// ---- SDL_malloc hooks ----
+// sizes of freed blocks are unknown without a header, and a header would break blocks SDL handed
+// out before the hooks went in, so only allocations carry a byte count
+
+static SDL_malloc_func s_sdl_malloc;
+static SDL_calloc_func s_sdl_calloc;
+static SDL_realloc_func s_sdl_realloc;
+static SDL_free_func s_sdl_free;
+
+static const char* SDL_POOL = "SDL";
+
+static void* SDLCALL tracked_sdl_malloc(size_t size) {
+    void* ptr = s_sdl_malloc(size);
+    if (ptr) {
+        count_alloc(size);
+        track_alloc_n(ptr, size, SDL_POOL);
+    }
+    return ptr;
+}
+
+static void* SDLCALL tracked_sdl_calloc(size_t nmemb, size_t size) {
+    void* ptr = s_sdl_calloc(nmemb, size);
+    if (ptr) {
+        count_alloc(nmemb * size);
+        track_alloc_n(ptr, nmemb * size, SDL_POOL);
+    }
+    return ptr;
+}
+
+static void* SDLCALL tracked_sdl_realloc(void* mem, size_t size) {
+    void* ptr = s_sdl_realloc(mem, size);
+    if (!ptr) return nullptr;  // mem is still live
+
+    if (mem) {
+        count_free();
+        track_free_n(mem, SDL_POOL);
+    }
+    count_alloc(size);
+    track_alloc_n(ptr, size, SDL_POOL);
+    return ptr;
+}
+
+static void SDLCALL tracked_sdl_free(void* mem) {
+    if (!mem) return;
+
+    count_free();
+    track_free_n(mem, SDL_POOL);
+    s_sdl_free(mem);
+}
+
+static bool install_sdl_hooks() {
+    SDL_GetOriginalMemoryFunctions(&s_sdl_malloc, &s_sdl_calloc, &s_sdl_realloc, &s_sdl_free);
+    if (!SDL_SetMemoryFunctions(
+            tracked_sdl_malloc, tracked_sdl_calloc, tracked_sdl_realloc, tracked_sdl_free)) {
+        SDL_Log("Failed to install SDL memory hooks: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+// installed during static initialisation, before the SDL_main entry point has allocated anything.
+// from SDL_AppInit blocks made through the original functions would later be reported as frees
+// of allocations tracy never saw
+static const bool s_sdl_hooks_installed = install_sdl_hooks();
+
+// ---- global new/delete ----
+// the nothrow, array and sized forms all forward to these by default
+
+void* operator new(size_t size) {
+    if (size == 0) size = 1;
+
+    void* ptr = std::malloc(size);
+    if (!ptr) throw std::bad_alloc();
+
+    count_alloc(size);
+    track_alloc(ptr, size);
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+
+    count_free();
+    track_free(ptr);
+    std::free(ptr);
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    if (size == 0) size = 1;
+
+#if defined(_WIN32)
+    void* ptr = _aligned_malloc(size, (size_t)align);
+#else
+    size_t a = (size_t)align;
+    void* ptr = std::aligned_alloc(a, (size + a - 1) / a * a);
+#endif
+    if (!ptr) throw std::bad_alloc();
+
+    count_alloc(size);
+    track_alloc(ptr, size);
+    return ptr;
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    if (!ptr) return;
+
+    count_free();
+    track_free(ptr);
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef ALLOC_TRACKING_H
+#define ALLOC_TRACKING_H
+
+#include <stdint.h>
+
+// opt-in heap instrumentation, built with `xmake f --alloc_tracking=y`. global new/delete are
+// replaced and SDL_malloc is wrapped before main runs, every allocation is counted per thread,
+// reported to tracy as a memory event and, inside zone_scoped_n zones, attached to the zone as text
+
+struct alloc_counters {
+    uint64_t allocs = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;  // requested bytes, frees are not subtracted
+};
+
+#if defined(KUROMASU_ALLOC_TRACKING)
+
+// counters of the calling thread since it started
+alloc_counters alloc_tracking_thread();
+// counters of every thread since startup
+alloc_counters alloc_tracking_total();
+
+// rolls the per frame counters, call once at the top of SDL_AppIterate
+void alloc_tracking_frame();
+// what the main thread allocated during the previous frame
+alloc_counters alloc_tracking_last_frame();
+
+#ifdef TRACY_ENABLE
+#include "tracy/Tracy.hpp"
+
+struct alloc_zone_scope {
+    tracy::ScopedZone& zone;
+    alloc_counters start;
+
+    alloc_zone_scope(tracy::ScopedZone& z) : zone(z), start(alloc_tracking_thread()) {}
+    ~alloc_zone_scope() {
+        alloc_counters now = alloc_tracking_thread();
+        uint64_t allocs = now.allocs - start.allocs;
+        if (allocs == 0) return;
+
+        zone.TextFmt("%llu allocs, %llu bytes",
+            (unsigned long long)allocs,
+            (unsigned long long)(now.bytes - start.bytes));
+    }
+};
+#endif
+
+#else
+
+inline alloc_counters alloc_tracking_thread() { return {}; }
+inline alloc_counters alloc_tracking_total() { return {}; }
+inline void alloc_tracking_frame() {}
+inline alloc_counters alloc_tracking_last_frame() { return {}; }
+
+#endif
+
+#endif /* ALLOC_TRACKING_H */
@@ -0,0 +1,42 @@
+#include "animation.h"
+
+static void mistake_fades_sync(mistake_fades& f, const state_t& s) {
+    zone_scoped_n("sync mistake fades");
+
+    // a rebuilt board shares no cells with the old one even at the same size, an endless pan
+    // re-indexes every cell. only re-checks of the same board carry starts over
+    if (f.synced_board != s.board_version) f.active.clear();
+
+    std::swap(f.active, f.scratch);
+    f.active.clear();
+
+    // both sides are row major, so carrying the starts over is a single merge
+    size_t k = 0;
+    for (size_t i = 0; i < s.mistakes.size(); i++) {
+        if (!s.mistakes[i]) continue;
+
+        while (k < f.scratch.size() && f.scratch[k].index < i) {
+            k++;
+        }
+        bool kept = k < f.scratch.size() && f.scratch[k].index == i;
+        f.active.push_back({.index = (uint32_t)i, .start = kept ? f.scratch[k].start : f.clock});
+    }
+
+    f.synced_version = s.mistakes_version;
+    f.synced_board = s.board_version;
+}
+
+void mistake_fades_update(mistake_fades& f, const state_t& s) {
+    zone_scoped_n("mistake fades");
+
+    f.clock += s.dt;
+    if (f.synced_version != s.mistakes_version || f.synced_board != s.board_version) {
+        mistake_fades_sync(f, s);
+    }
+
+    f.running = false;
+    for (auto& m : f.active) {
+        m.alpha = std::clamp((f.clock - m.start - MISTAKE_DELAY) * MISTAKE_FADE_SPEED, 0.0f, 1.0f);
+        f.running |= m.alpha < 1.0f;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "common.h"
+
+constexpr float MISTAKE_DELAY = 1.0f;       // seconds before a mistake circle starts to show
+constexpr float MISTAKE_FADE_SPEED = 2.0f;  // alpha per second once it does
+
+// only cells that are mistakes have a fade, kept in row major order. the set is rebuilt from
+// s.mistakes when solve() has rewritten them, cells that stay mistakes keep their start so a
+// re-check does not restart their circle, a board rebuilt by apply_puzzle() starts from nothing.
+// every other frame is one loop over the active fades
+void mistake_fades_update(mistake_fades& f, const state_t& s);
+
+// whether some circle is still fading in, when none is the board looks the same next frame
+inline bool mistake_fades_running(const mistake_fades& f) { return f.running; }
+
+#endif /* ANIMATION_H */
@@ -0,0 +1,397 @@
+#include "batch.h"
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include "canonical.h"
+#include "connectivity.h"
+#include "deduction.h"
+#include "kernels.h"
+#include "kuromasu.h"
+#include "pack.h"
+
+// seeds tried per board before giving up on finding one that is new (and unique with --unique)
+constexpr size_t BATCH_MAX_ATTEMPTS = 64;
+
+// upper bound on the boards remembered for deduplication, around 32 bytes each. every board up
+// to it is kept exactly, past it new boards are no longer remembered and a repeat of one of them
+// can slip through
+constexpr size_t BATCH_DEDUPE_CAPACITY = 1 << 22;
+
+// canonical_hash() of every board kept so far
+using dedupe_set = std::unordered_set<uint64_t>;
+
+static void init_dedupe_set(dedupe_set& seen, size_t count) {
+    seen.reserve(std::min(count, BATCH_DEDUPE_CAPACITY));
+}
+
+static void remember_board(dedupe_set& seen, uint64_t key) {
+    if (seen.size() < BATCH_DEDUPE_CAPACITY) seen.insert(key);
+}
+
+static SDL_AppResult make_pack(int argc, char** argv) {
+    zone_scoped_n("make pack");
+
+    generation_params params;
+    bool unique = false;
+
+    // options may appear anywhere after the command, everything else is positional
+    std::vector<const char*> args;
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--minimize") == 0) {
+            params.minimize = true;
+        } else if (std::strcmp(argv[i], "--unique") == 0) {
+            unique = true;
+        } else if (std::strcmp(argv[i], "--difficulty") == 0 && i + 2 < argc) {
+            params.difficulty = {.enabled = true,
+                .min = std::strtof(argv[i + 1], nullptr),
+                .max = std::strtof(argv[i + 2], nullptr)};
+            i += 2;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+
+    if (args.size() < 2) {
+        SDL_Log("usage: %s --make-pack <out> <count> [width height black%% observer%%] "
+                "[--minimize] [--unique] [--difficulty min max]",
+            argv[0]);
+        return SDL_APP_FAILURE;
+    }
+
+    const char* path = args[0];
+    size_t count = std::strtoull(args[1], nullptr, 10);
+
+    if (args.size() >= 6) {
+        params.width = std::strtoull(args[2], nullptr, 10);
+        params.height = std::strtoull(args[3], nullptr, 10);
+        params.black_chance = std::strtof(args[4], nullptr);
+        params.observer_chance = std::strtof(args[5], nullptr);
+    }
+
+    if (params.difficulty.enabled && params.difficulty.min > params.difficulty.max) {
+        SDL_Log("difficulty band is empty");
+        return SDL_APP_FAILURE;
+    }
+
+    if (params.width < BOARD_MIN_SIDE || params.height < BOARD_MIN_SIDE ||
+        params.width > BOARD_MAX_SIDE || params.height > BOARD_MAX_SIDE) {
+        SDL_Log("board size must be between %zu and %zu", BOARD_MIN_SIDE, BOARD_MAX_SIDE);
+        return SDL_APP_FAILURE;
+    }
+
+    // the pack can only hold rounded chances, generate with exactly what will be stored
+    params = pack_quantize_params(params);
+
+    puzzle_pack pack;
+    pack.records.reserve(count);
+    pack_set_difficulty_band(pack, params.difficulty);
+
+    generation_stats before = get_generation_stats();
+    uint64_t start = SDL_GetTicksNS();
+    // canonical forms already in the pack, a mirrored or rotated board counts as a repeat
+    dedupe_set seen;
+    init_dedupe_set(seen, count);
+
+    size_t duplicates = 0;
+    size_t rejected = 0;
+    size_t off_band = 0;
+    for (size_t i = 0; i < count; i++) {
+        // the pack only stores the seed, so a repeated board, one with a second solution or one
+        // whose steering gave up outside the band is simply skipped
+        puzzle_t p;
+        for (size_t attempt = 0;; attempt++) {
+            if (attempt == BATCH_MAX_ATTEMPTS) {
+                SDL_Log("no new board after %zu seeds, %zu of %zu done",
+                    BATCH_MAX_ATTEMPTS,
+                    pack.records.size(),
+                    count);
+                return SDL_APP_FAILURE;
+            }
+
+            p = generate_puzzle(params);
+            if (p.band_missed) {
+                off_band++;
+            } else if (seen.contains(canonical_hash(p))) {
+                duplicates++;
+            } else if (unique && count_solutions(p, 2) != 1) {
+                rejected++;
+            } else {
+                break;
+            }
+        }
+
+        remember_board(seen, canonical_hash(p));
+        pack.records.push_back(pack_record_from_puzzle(p));
+    }
+    double seconds = (double)(SDL_GetTicksNS() - start) / 1e9;
+    generation_stats after = get_generation_stats();
+
+    auto err = pack_save(pack, path);
+    if (err != pack_error::OK) {
+        SDL_Log("failed to write %s: %s", path, get_pack_error_message(err));
+        return SDL_APP_FAILURE;
+    }
+
+    SDL_Log("wrote %zu puzzles to %s in %.2fs (%.0f boards/s)",
+        pack.records.size(),
+        path,
+        seconds,
+        seconds > 0 ? pack.records.size() / seconds : 0.0);
+
+    SDL_Log("%zu duplicate boards skipped", duplicates);
+    if (unique) { SDL_Log("%zu boards with more than one solution skipped", rejected); }
+
+    if (params.difficulty.enabled) {
+        uint64_t candidates = after.candidates - before.candidates;
+        uint64_t accepted = after.accepted - before.accepted;
+        SDL_Log("%llu candidates for %llu accepted boards (%.2f per board)",
+            (unsigned long long)candidates,
+            (unsigned long long)accepted,
+            accepted ? (double)candidates / accepted : 0.0);
+        SDL_Log("%zu boards outside the difficulty band skipped", off_band);
+    }
+
+    return SDL_APP_SUCCESS;
+}
+
+static SDL_AppResult dedupe_pack(int argc, char** argv) {
+    zone_scoped_n("dedupe pack");
+
+    if (argc < 4) {
+        SDL_Log("usage: %s --dedupe-pack <in> <out>", argv[0]);
+        return SDL_APP_FAILURE;
+    }
+
+    puzzle_pack pack;
+    auto err = pack_load(pack, argv[2]);
+    if (err != pack_error::OK) {
+        SDL_Log("failed to read %s: %s", argv[2], get_pack_error_message(err));
+        return SDL_APP_FAILURE;
+    }
+
+    dedupe_set seen;
+    init_dedupe_set(seen, pack.records.size());
+
+    // records only hold seeds, every board is regenerated to get at its clues
+    uint64_t start = SDL_GetTicksNS();
+    size_t kept = 0;
+    for (const pack_record& rec : pack.records) {
+        puzzle_t p = generate_puzzle(pack_record_params(pack, rec), rec.seed);
+
+        uint64_t key = canonical_hash(p);
+        if (seen.contains(key)) continue;
+
+        remember_board(seen, key);
+        pack.records[kept++] = rec;
+    }
+    double seconds = (double)(SDL_GetTicksNS() - start) / 1e9;
+
+    size_t total = pack.records.size();
+    pack.records.resize(kept);
+
+    err = pack_save(pack, argv[3]);
+    if (err != pack_error::OK) {
+        SDL_Log("failed to write %s: %s", argv[3], get_pack_error_message(err));
+        return SDL_APP_FAILURE;
+    }
+
+    SDL_Log("kept %zu of %zu puzzles in %.2fs (%.0f boards/s)",
+        kept,
+        total,
+        seconds,
+        seconds > 0 ? total / seconds : 0.0);
+
+    return SDL_APP_SUCCESS;
+}
+
+static SDL_AppResult verify_pack(int argc, char** argv) {
+    zone_scoped_n("verify pack");
+
+    if (argc < 3) {
+        SDL_Log("usage: %s --verify-pack <pack>", argv[0]);
+        return SDL_APP_FAILURE;
+    }
+
+    puzzle_pack pack;
+    auto err = pack_load(pack, argv[2]);
+    if (err != pack_error::OK) {
+        SDL_Log("failed to read %s: %s", argv[2], get_pack_error_message(err));
+        return SDL_APP_FAILURE;
+    }
+
+    size_t broken = 0;
+    size_t solved = 0;
+    size_t searched = 0;
+    size_t ambiguous = 0;
+
+    // boards of one size are propagated KERNEL_BATCH_LANES at a time, most fall to the rules
+    // alone and only the rest pay for a search
+    std::vector<std::pair<size_t, puzzle_t>> pending;
+    std::vector<const observer_table*> boards;
+    std::vector<kernel_result> results;
+    auto flush = [&]() {
+        if (pending.empty()) return;
+
+        boards.clear();
+        for (auto& entry : pending) {
+            boards.push_back(&entry.second.observers);
+        }
+        const generation_params& params = pending.front().second.params;
+        propagate_clues_batch(params.width, params.height, boards, results);
+
+        for (size_t k = 0; k < pending.size(); k++) {
+            if (results[k] == kernel_result::SOLVED) {
+                solved++;
+                continue;
+            }
+
+            auto& [i, p] = pending[k];
+            if (results[k] == kernel_result::CONTRADICTION) {
+                SDL_Log("record %zu (seed %u) has no solution", i, p.seed);
+                broken++;
+                continue;
+            }
+
+            searched++;
+            size_t solutions = count_solutions(p, 2);
+            if (solutions == 0) {
+                SDL_Log("record %zu (seed %u) has no solution", i, p.seed);
+                broken++;
+            } else if (solutions > 1) {
+                SDL_Log("record %zu (seed %u) has more than one solution", i, p.seed);
+                ambiguous++;
+            }
+        }
+        pending.clear();
+    };
+
+    uint64_t start = SDL_GetTicksNS();
+    for (size_t i = 0; i < pack.records.size(); i++) {
+        const pack_record& rec = pack.records[i];
+        puzzle_t p = generate_puzzle(pack_record_params(pack, rec), rec.seed);
+
+        if (clue_checksum(p.observers) != rec.checksum ||
+            !check_solution(p.params.width, p.params.height, p.observers, p.solution)) {
+            SDL_Log("record %zu (seed %u) does not rebuild its board", i, rec.seed);
+            broken++;
+            continue;
+        }
+
+        if (!pending.empty() && (pending.front().second.params.width != p.params.width ||
+                                    pending.front().second.params.height != p.params.height)) {
+            flush();
+        }
+        pending.emplace_back(i, std::move(p));
+        if (pending.size() == KERNEL_BATCH_LANES) flush();
+    }
+    flush();
+    double seconds = (double)(SDL_GetTicksNS() - start) / 1e9;
+
+    SDL_Log("verified %zu puzzles in %.2fs (%.0f boards/s), %zu by the rules alone, %zu searched",
+        pack.records.size(),
+        seconds,
+        seconds > 0 ? pack.records.size() / seconds : 0.0,
+        solved,
+        searched);
+
+    if (broken || ambiguous) {
+        SDL_Log("%zu broken and %zu ambiguous puzzles", broken, ambiguous);
+        return SDL_APP_FAILURE;
+    }
+
+    return SDL_APP_SUCCESS;
+}
+
+// the rows of a text board go straight into the scanline check, nothing but the current row and
+// the check's O(width) state is held whatever the height
+static SDL_AppResult check_board(int argc, char** argv) {
+    zone_scoped_n("check board");
+
+    if (argc < 3) {
+        SDL_Log("usage: %s --check-board <board.txt>", argv[0]);
+        return SDL_APP_FAILURE;
+    }
+
+    SDL_IOStream* io = SDL_IOFromFile(argv[2], "rb");
+    if (!io) {
+        SDL_Log("failed to open %s: %s", argv[2], SDL_GetError());
+        return SDL_APP_FAILURE;
+    }
+
+    scanline_connectivity s;
+    std::vector<cell> row;
+    bool ragged = false;
+    auto end_row = [&]() {
+        if (row.empty()) return;
+        if (s.rows == 0 && s.width == 0) scanline_init(s, row.size());
+
+        if (row.size() != s.width) {
+            ragged = true;
+        } else {
+            scanline_push(s, row.data());
+        }
+        row.clear();
+    };
+
+    uint64_t start = SDL_GetTicksNS();
+    char buffer[1 << 16];
+    for (size_t n; !ragged && (n = SDL_ReadIO(io, buffer, sizeof(buffer))) > 0;) {
+        for (size_t i = 0; i < n; i++) {
+            switch (buffer[i]) {
+                case '\n':
+                    end_row();
+                    break;
+                case '\r':
+                    break;
+                case '#':
+                    row.push_back({.type = cell::black});
+                    break;
+                case '?':
+                    row.push_back({.type = cell::blank});
+                    break;
+                default:
+                    row.push_back({.type = cell::white});
+                    break;
+            }
+        }
+    }
+    end_row();
+    SDL_CloseIO(io);
+    double seconds = (double)(SDL_GetTicksNS() - start) / 1e9;
+
+    if (ragged) {
+        SDL_Log("%s: row %zu is not %zu cells wide", argv[2], s.rows + 1, s.width);
+        return SDL_APP_FAILURE;
+    }
+
+    bool connected = scanline_connected(s);
+    SDL_Log("%zux%zu board in %.2fs: whites %s, %s",
+        s.width,
+        s.rows,
+        seconds,
+        connected ? "connected" : "split",
+        s.blacks_touch ? "touching blacks" : "no touching blacks");
+
+    return connected && !s.blacks_touch ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+}
+
+bool is_batch_command(int argc, char** argv) {
+    if (argc < 2) return false;
+
+    for (const char* command : {"--make-pack", "--dedupe-pack", "--verify-pack", "--check-board"}) {
+        if (std::strcmp(argv[1], command) == 0) return true;
+    }
+    return false;
+}
+
+SDL_AppResult run_batch_command(int argc, char** argv) {
+    SDL_AppResult result = SDL_APP_FAILURE;
+
+    if (std::strcmp(argv[1], "--make-pack") == 0) { result = make_pack(argc, argv); }
+    if (std::strcmp(argv[1], "--dedupe-pack") == 0) { result = dedupe_pack(argc, argv); }
+    if (std::strcmp(argv[1], "--verify-pack") == 0) { result = verify_pack(argc, argv); }
+    if (std::strcmp(argv[1], "--check-board") == 0) { result = check_board(argc, argv); }
+
+    release_generation_arena();
+    return result;
+}
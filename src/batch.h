@@ -0,0 +1,20 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "common.h"
+
+// headless tools run instead of the game when the first argument names one:
+//   --make-pack <out> <count> [width height black% observer%] [--minimize] [--unique]
+//               [--difficulty min max]
+//   --dedupe-pack <in> <out>
+//   --verify-pack <pack>
+//   --check-board <board.txt>
+// make-pack skips boards it already has, dedupe-pack drops repeats from an existing pack. a
+// rotated or mirrored board counts as a repeat in both. verify-pack rebuilds every board and
+// checks it against its checksum, its solution and for a second solution. check-board streams
+// a text board of any size, one row per line with '#' for black and '?' for blank, and checks
+// that no blacks touch and the whites are connected
+bool is_batch_command(int argc, char** argv);
+SDL_AppResult run_batch_command(int argc, char** argv);
+
+#endif /* BATCH_H */
@@ -0,0 +1,119 @@
+#include "bitboard.h"
+#include <algorithm>
+
+void bit_plane::resize(size_t new_width, size_t new_height) {
+    width = new_width;
+    height = new_height;
+    row_words = (new_width + 63) / 64;
+    w.assign(row_words * new_height, 0);
+}
+
+bool plane_first(const bit_plane& p, size_t& x, size_t& y) {
+    for (size_t i = 0; i < p.w.size(); i++) {
+        if (!p.w[i]) continue;
+        y = i / p.row_words;
+        x = (i % p.row_words) * 64 + (size_t)std::countr_zero(p.w[i]);
+        return true;
+    }
+    return false;
+}
+
+size_t plane_count(const bit_plane& p) {
+    size_t n = 0;
+    for (uint64_t v : p.w) {
+        n += (size_t)std::popcount(v);
+    }
+    return n;
+}
+
+void plane_and_not(bit_plane& a, const bit_plane& b) {
+    for (size_t i = 0; i < a.w.size(); i++) {
+        a.w[i] &= ~b.w[i];
+    }
+}
+
+// occluded fills: every bit of gen spreads through the runs of pro it sits in, doubling the
+// distance with each step so 6 of them cover a whole word
+static uint64_t fill_up(uint64_t gen, uint64_t pro) {
+    gen |= pro & (gen << 1);
+    pro &= pro << 1;
+    gen |= pro & (gen << 2);
+    pro &= pro << 2;
+    gen |= pro & (gen << 4);
+    pro &= pro << 4;
+    gen |= pro & (gen << 8);
+    pro &= pro << 8;
+    gen |= pro & (gen << 16);
+    pro &= pro << 16;
+    return gen | (pro & (gen << 32));
+}
+
+static uint64_t fill_down(uint64_t gen, uint64_t pro) {
+    gen |= pro & (gen >> 1);
+    pro &= pro >> 1;
+    gen |= pro & (gen >> 2);
+    pro &= pro >> 2;
+    gen |= pro & (gen >> 4);
+    pro &= pro >> 4;
+    gen |= pro & (gen >> 8);
+    pro &= pro >> 8;
+    gen |= pro & (gen >> 16);
+    pro &= pro >> 16;
+    return gen | (pro & (gen >> 32));
+}
+
+// spreads r along the runs of a within one row, across word boundaries too
+static void fill_row(uint64_t* r, const uint64_t* a, size_t n) {
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t k = 0; k < n; k++) {
+            uint64_t x = r[k];
+            if (k > 0) x |= (r[k - 1] >> 63) & a[k];
+            if (k + 1 < n) x |= (r[k + 1] << 63) & a[k];
+            x = fill_down(fill_up(x, a[k]), a[k]);
+
+            if (x != r[k]) {
+                r[k] = x;
+                changed = true;
+            }
+        }
+    }
+}
+
+// row y takes whatever row `from` reached and spreads it along itself
+static bool grow_row(bit_plane& r, const bit_plane& a, size_t y, size_t from) {
+    uint64_t* row = r.row(y);
+    const uint64_t* src = r.row(from);
+    const uint64_t* allowed = a.row(y);
+
+    bool grew = false;
+    for (size_t k = 0; k < r.row_words; k++) {
+        uint64_t add = src[k] & allowed[k] & ~row[k];
+        if (!add) continue;
+        row[k] |= add;
+        grew = true;
+    }
+
+    if (grew) fill_row(row, allowed, r.row_words);
+    return grew;
+}
+
+void flood_plane(bit_plane& reached, const bit_plane& allowed) {
+    if (!reached.height) return;
+
+    for (size_t y = 0; y < reached.height; y++) {
+        fill_row(reached.row(y), allowed.row(y), reached.row_words);
+    }
+
+    // sweeping down and then up carries the flood through every row in one go, it only takes
+    // another round where a path turns back on itself
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t y = 1; y < reached.height; y++) {
+            changed |= grow_row(reached, allowed, y, y - 1);
+        }
+        for (size_t y = reached.height - 1; y-- > 0;) {
+            changed |= grow_row(reached, allowed, y, y + 1);
+        }
+    }
+}
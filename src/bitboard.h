@@ -0,0 +1,204 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <bit>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// one bit per cell of a board whose size is known at compile time, row major. up to 8x8 is a
+// single word, up to 11x11 two, up to 16x16 four. every loop over the words has a constant trip
+// count so the compiler unrolls it, and the masks the shifts need are generated at compile time
+
+template <size_t W, size_t H>
+struct bitboard {
+    static constexpr size_t CELLS = W * H;
+    static constexpr size_t WORDS = (CELLS + 63) / 64;
+
+    std::array<uint64_t, WORDS> w{};
+
+    constexpr void set(size_t i) { w[i / 64] |= 1ull << (i % 64); }
+    constexpr bool test(size_t i) const { return (w[i / 64] >> (i % 64)) & 1; }
+
+    constexpr bool any() const {
+        uint64_t acc = 0;
+        for (size_t k = 0; k < WORDS; k++) {
+            acc |= w[k];
+        }
+        return acc != 0;
+    }
+
+    constexpr size_t count() const {
+        size_t n = 0;
+        for (size_t k = 0; k < WORDS; k++) {
+            n += (size_t)std::popcount(w[k]);
+        }
+        return n;
+    }
+
+    // index of the lowest / highest set bit, -1 when empty
+    constexpr int lowest() const {
+        for (size_t k = 0; k < WORDS; k++) {
+            if (w[k]) return (int)(k * 64 + std::countr_zero(w[k]));
+        }
+        return -1;
+    }
+
+    constexpr int highest() const {
+        for (size_t k = WORDS; k-- > 0;) {
+            if (w[k]) return (int)(k * 64 + 63 - std::countl_zero(w[k]));
+        }
+        return -1;
+    }
+
+    // moves every bit n cells towards higher indices, bits past the last cell are not cleared
+    constexpr bitboard shl(size_t n) const {
+        bitboard r;
+        size_t words = n / 64, bits = n % 64;
+        for (size_t k = WORDS; k-- > words;) {
+            uint64_t v = w[k - words] << bits;
+            if (bits && k > words) v |= w[k - words - 1] >> (64 - bits);
+            r.w[k] = v;
+        }
+        return r;
+    }
+
+    constexpr bitboard shr(size_t n) const {
+        bitboard r;
+        size_t words = n / 64, bits = n % 64;
+        for (size_t k = 0; k + words < WORDS; k++) {
+            uint64_t v = w[k + words] >> bits;
+            if (bits && k + words + 1 < WORDS) v |= w[k + words + 1] << (64 - bits);
+            r.w[k] = v;
+        }
+        return r;
+    }
+
+    constexpr bitboard& operator&=(const bitboard& o) {
+        for (size_t k = 0; k < WORDS; k++) {
+            w[k] &= o.w[k];
+        }
+        return *this;
+    }
+
+    constexpr bitboard& operator|=(const bitboard& o) {
+        for (size_t k = 0; k < WORDS; k++) {
+            w[k] |= o.w[k];
+        }
+        return *this;
+    }
+
+    friend constexpr bitboard operator&(bitboard a, const bitboard& b) { return a &= b; }
+    friend constexpr bitboard operator|(bitboard a, const bitboard& b) { return a |= b; }
+
+    // a & ~b
+    friend constexpr bitboard and_not(bitboard a, const bitboard& b) {
+        for (size_t k = 0; k < WORDS; k++) {
+            a.w[k] &= ~b.w[k];
+        }
+        return a;
+    }
+
+    friend constexpr bool operator==(const bitboard&, const bitboard&) = default;
+};
+
+template <size_t W, size_t H>
+struct bitboard_masks {
+    static constexpr size_t CELLS = W * H;
+
+    bitboard<W, H> valid;
+    bitboard<W, H> not_first_col;
+    bitboard<W, H> not_last_col;
+
+    // cells strictly past each cell, per direction in ray_dx / ray_dy order: left, right, up, down
+    bitboard<W, H> ray[4][CELLS];
+};
+
+template <size_t W, size_t H>
+constexpr bitboard_masks<W, H> make_bitboard_masks() {
+    constexpr int dx[4] = {-1, 1, 0, 0};
+    constexpr int dy[4] = {0, 0, -1, 1};
+
+    bitboard_masks<W, H> m{};
+    for (size_t y = 0; y < H; y++) {
+        for (size_t x = 0; x < W; x++) {
+            size_t i = y * W + x;
+            m.valid.set(i);
+            if (x > 0) m.not_first_col.set(i);
+            if (x + 1 < W) m.not_last_col.set(i);
+
+            for (int d = 0; d < 4; d++) {
+                int cx = (int)x + dx[d];
+                int cy = (int)y + dy[d];
+                while (cx >= 0 && cy >= 0 && cx < (int)W && cy < (int)H) {
+                    m.ray[d][i].set((size_t)cy * W + (size_t)cx);
+                    cx += dx[d];
+                    cy += dy[d];
+                }
+            }
+        }
+    }
+    return m;
+}
+
+template <size_t W, size_t H>
+inline constexpr bitboard_masks<W, H> bitboard_masks_v = make_bitboard_masks<W, H>();
+
+// every cell next to one in b, b itself included
+template <size_t W, size_t H>
+constexpr bitboard<W, H> dilate(const bitboard<W, H>& b) {
+    constexpr const auto& m = bitboard_masks_v<W, H>;
+    bitboard<W, H> r = b;
+    r |= b.shl(1) & m.not_first_col;
+    r |= b.shr(1) & m.not_last_col;
+    r |= b.shl(W);
+    r |= b.shr(W);
+    return r & m.valid;
+}
+
+// grows from seed inside allowed until it stops changing
+template <size_t W, size_t H>
+constexpr bitboard<W, H> flood(bitboard<W, H> seed, const bitboard<W, H>& allowed) {
+    seed &= allowed;
+    for (;;) {
+        bitboard<W, H> next = dilate(seed) & allowed;
+        if (next == seed) return seed;
+        seed = next;
+    }
+}
+
+// runtime sized counterpart for boards of any size. rows are padded to whole words so no bit
+// spills from one row into the next, a row is filled along its length in a handful of shifts and
+// the flood only has to carry bits between rows
+struct bit_plane {
+    size_t width = 0;
+    size_t height = 0;
+    size_t row_words = 0;
+    std::vector<uint64_t> w;
+
+    // clears every cell
+    void resize(size_t new_width, size_t new_height);
+    void clear() { std::fill(w.begin(), w.end(), 0); }
+
+    uint64_t* row(size_t y) { return w.data() + y * row_words; }
+    const uint64_t* row(size_t y) const { return w.data() + y * row_words; }
+
+    void set(size_t x, size_t y) { row(y)[x / 64] |= 1ull << (x % 64); }
+    void reset(size_t x, size_t y) { row(y)[x / 64] &= ~(1ull << (x % 64)); }
+    bool test(size_t x, size_t y) const { return (row(y)[x / 64] >> (x % 64)) & 1; }
+
+    bool operator==(const bit_plane&) const = default;
+};
+
+// first set cell in row major order, false when the plane is empty
+bool plane_first(const bit_plane& p, size_t& x, size_t& y);
+size_t plane_count(const bit_plane& p);
+
+// a &= ~b, both the same size
+void plane_and_not(bit_plane& a, const bit_plane& b);
+
+// grows reached inside allowed until it stops changing, reached has to start inside allowed
+void flood_plane(bit_plane& reached, const bit_plane& allowed);
+
+#endif /* BITBOARD_H */
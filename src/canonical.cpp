@@ -0,0 +1,103 @@
+#include "canonical.h"
+#include "zobrist.h"
+
+constexpr size_t TRANSPOSE_TILE = 16;
+
+void clue_grid_from_observers(clue_grid& out,
+    size_t width,
+    size_t height,
+    const observer_table& observers) {
+    out.width = width;
+    out.height = height;
+    out.cells.assign(width * height, 0);
+
+    for (auto& o : observers) {
+        out.cells[o.pos.y * width + o.pos.x] = (uint16_t)std::clamp(o.value + 1, 1, UINT16_MAX);
+    }
+}
+
+void transpose_clues(const clue_grid& in, clue_grid& out) {
+    out.width = in.height;
+    out.height = in.width;
+    out.cells.resize(in.cells.size());
+
+    const uint16_t* src = in.cells.data();
+    uint16_t* dst = out.cells.data();
+
+    for (size_t by = 0; by < in.height; by += TRANSPOSE_TILE) {
+        size_t ey = std::min(by + TRANSPOSE_TILE, in.height);
+        for (size_t bx = 0; bx < in.width; bx += TRANSPOSE_TILE) {
+            size_t ex = std::min(bx + TRANSPOSE_TILE, in.width);
+            for (size_t x = bx; x < ex; x++) {
+                for (size_t y = by; y < ey; y++) {
+                    dst[x * in.height + y] = src[y * in.width + x];
+                }
+            }
+        }
+    }
+}
+
+void reverse_rows(clue_grid& g) {
+    for (size_t y = 0; y < g.height; y++) {
+        auto row = g.cells.begin() + y * g.width;
+        std::reverse(row, row + g.width);
+    }
+}
+
+void reverse_columns(clue_grid& g) {
+    for (size_t top = 0, bottom = g.height; top + 1 < bottom; top++) {
+        bottom--;
+        std::swap_ranges(g.cells.begin() + top * g.width,
+            g.cells.begin() + (top + 1) * g.width,
+            g.cells.begin() + bottom * g.width);
+    }
+}
+
+bool clue_grid_less(const clue_grid& a, const clue_grid& b) {
+    if (a.width != b.width) return a.width < b.width;
+    if (a.height != b.height) return a.height < b.height;
+    return std::lexicographical_compare(
+        a.cells.begin(), a.cells.end(), b.cells.begin(), b.cells.end());
+}
+
+symmetry canonicalize(const clue_grid& g, clue_grid& out) {
+    zone_scoped_n("canonicalize");
+
+    static thread_local clue_grid transposed;
+    static thread_local clue_grid image;
+
+    transpose_clues(g, transposed);
+
+    // the symmetry's bits read as: transpose first, then mirror left to right, then top to bottom
+    symmetry best = SYM_IDENTITY;
+    for (int s = 0; s < SYM_COUNT; s++) {
+        const clue_grid& src = s & 4 ? transposed : g;
+        image.width = src.width;
+        image.height = src.height;
+        image.cells.assign(src.cells.begin(), src.cells.end());
+
+        if (s & 1) reverse_rows(image);
+        if (s & 2) reverse_columns(image);
+
+        if (s == SYM_IDENTITY || clue_grid_less(image, out)) {
+            std::swap(image, out);
+            best = (symmetry)s;
+        }
+    }
+
+    return best;
+}
+
+uint64_t canonical_hash(size_t width, size_t height, const observer_table& observers) {
+    static thread_local clue_grid clues;
+    static thread_local clue_grid canonical;
+
+    clue_grid_from_observers(clues, width, height, observers);
+    canonicalize(clues, canonical);
+
+    uint64_t h = zobrist_dims(canonical.width, canonical.height);
+    for (size_t i = 0; i < canonical.cells.size(); i++) {
+        if (canonical.cells[i]) h ^= zobrist_observer(i, canonical.cells[i] - 1);
+    }
+    return h;
+}
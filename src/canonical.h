@@ -0,0 +1,54 @@
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include "common.h"
+
+// clue sets up to rotation and reflection. a puzzle and its 7 mirror images are the same puzzle
+// to a player, the canonical form is the smallest of their encodings and hashing it gives every
+// one of them the same key
+//
+// the clues are packed into a dense row major grid of uint16 (0 for no clue, value + 1 otherwise)
+// so every symmetry is a transpose and/or whole row and column reversals over flat memory
+
+// the symmetries of the square, the ones from SYM_TRANSPOSE on swap width and height
+enum symmetry : uint8_t {
+    SYM_IDENTITY,
+    SYM_FLIP_X,          // mirror left to right
+    SYM_FLIP_Y,          // mirror top to bottom
+    SYM_ROTATE_180,
+    SYM_TRANSPOSE,       // mirror along the main diagonal
+    SYM_ROTATE_90,       // clockwise
+    SYM_ROTATE_270,      // clockwise
+    SYM_ANTI_TRANSPOSE,  // mirror along the other diagonal
+    SYM_COUNT,
+};
+
+struct clue_grid {
+    size_t width = 0;
+    size_t height = 0;
+    std::vector<uint16_t> cells;
+};
+
+void clue_grid_from_observers(clue_grid& out,
+    size_t width,
+    size_t height,
+    const observer_table& observers);
+
+// tiled, so both the rows read and the columns written stay in cache
+void transpose_clues(const clue_grid& in, clue_grid& out);
+void reverse_rows(clue_grid& g);
+void reverse_columns(clue_grid& g);
+
+// orders by size first, then cell by cell
+bool clue_grid_less(const clue_grid& a, const clue_grid& b);
+
+// writes the smallest of the 8 images into out and returns the symmetry that produces it
+symmetry canonicalize(const clue_grid& g, clue_grid& out);
+
+// zobrist hash of the canonical form, equal for a puzzle and all its mirror images
+uint64_t canonical_hash(size_t width, size_t height, const observer_table& observers);
+inline uint64_t canonical_hash(const puzzle_t& p) {
+    return canonical_hash(p.params.width, p.params.height, p.observers);
+}
+
+#endif /* CANONICAL_H */
@@ -12,17 +12,31 @@
 #include <imgui.h>
 #include <imgui_impl_sdl3.h>
 #include <imgui_impl_sdlrenderer3.h>
+#include <algorithm>
 #include <unordered_map>
+#include <vector>
 
 #ifdef TRACY_ENABLE
 #include "tracy/Tracy.hpp"
 
 #define frame_mark() FrameMark
-#define zone_scoped_n(name) ZoneScopedN(name)
 #define zone_text(fmt, ...) ZoneTextF(fmt, ##__VA_ARGS__)
-
 #define zone_color(color) ZoneColor(color)
+
+#if defined(KUROMASU_ALLOC_TRACKING)
+#include "alloc_tracking.h"
+
+// zones report what was allocated inside them as zone text
+#define zone_scoped_n(name) \
+    ZoneScopedN(name);      \
+    alloc_zone_scope ___alloc_zone_scope(___tracy_scoped_zone)
+#define zone_scoped_nc(name, color) \
+    ZoneScopedNC(name, color);      \
+    alloc_zone_scope ___alloc_zone_scope(___tracy_scoped_zone)
+#else
+#define zone_scoped_n(name) ZoneScopedN(name)
 #define zone_scoped_nc(name, color) ZoneScopedNC(name, color)
+#endif
 
 #define PROF_COLOR_RED 0xFF0000
 #define PROF_COLOR_GREEN 0x00FF00
@@ -46,19 +60,88 @@
 #define BUILD_IDENTIFIER "unknown-dev"
 #endif
 
+// only the solver relevant part of a cell lives in the grid, observers are kept in a sparse
+// table and everything presentation related is owned by the renderer
 struct cell {
-    enum type_t {
+    enum type_t : uint8_t {
         blank,
         black,
         white,
     } type = blank;
+};
+
+// directions in the order every clue pass walks them: left, right, up, down
+constexpr int ray_dx[4] = {-1, 1, 0, 0};
+constexpr int ray_dy[4] = {0, 0, -1, 1};
 
-    int observer_value = -1;
-    bool observer_satisfied = false;
-    bool mistake = false;
+struct observer {
+    ktl::pos2_size pos;
+    int value = -1;
+    bool satisfied = false;
 
-    float mistake_alpha = 0.0f;
-    float mistake_delay = 1.0f;
+    // furthest a ray can usefully walk in each direction: up to the board edge, but never past
+    // `value` cells, at that point the observer already sees too much. filled by index_observers()
+    uint32_t reach[4] = {0, 0, 0, 0};
+};
+
+// sorted in row major order, so lookups can binary search
+using observer_table = std::vector<observer>;
+
+inline bool observer_before(const observer& o, ktl::pos2_size p) {
+    return o.pos.y < p.y || (o.pos.y == p.y && o.pos.x < p.x);
+}
+
+inline observer* find_observer(observer_table& t, ktl::pos2_size p) {
+    auto it = std::lower_bound(t.begin(), t.end(), p, observer_before);
+    if (it == t.end() || it->pos != p) return nullptr;
+    return &*it;
+}
+
+inline const observer* find_observer(const observer_table& t, ktl::pos2_size p) {
+    auto it = std::lower_bound(t.begin(), t.end(), p, observer_before);
+    if (it == t.end() || it->pos != p) return nullptr;
+    return &*it;
+}
+
+// sorts the table and precomputes the ray bounds, call after any change to the observer layout
+inline void index_observers(observer_table& t, size_t width, size_t height) {
+    std::sort(t.begin(), t.end(), [](const observer& a, const observer& b) {
+        return observer_before(a, b.pos);
+    });
+
+    for (auto& o : t) {
+        size_t edge[4] = {o.pos.x, width - 1 - o.pos.x, o.pos.y, height - 1 - o.pos.y};
+        for (int d = 0; d < 4; d++) {
+            o.reach[d] = (uint32_t)std::min(edge[d], (size_t)std::max(o.value, 0));
+        }
+    }
+}
+
+inline bool is_observer(const observer_table& t, ktl::pos2_size p) {
+    return find_observer(t, p) != nullptr;
+}
+
+inline int observer_value(const observer_table& t, ktl::pos2_size p) {
+    auto o = find_observer(t, p);
+    return o ? o->value : -1;
+}
+
+// a mistake circle, only cells that currently are mistakes have one
+struct mistake_fade {
+    uint32_t index = 0;  // row major cell index
+    float start = 0.0f;  // fade clock when the cell became a mistake
+    float alpha = 0.0f;
+};
+
+// the mistake circles as a compact active set kept by the renderer, see animation.h
+struct mistake_fades {
+    float clock = 0.0f;
+    uint64_t synced_version = UINT64_MAX;  // state_t::mistakes_version the set was built from
+    uint64_t synced_board = UINT64_MAX;    // state_t::board_version the set was built on
+    bool running = false;  // some circle is still fading in
+
+    std::vector<mistake_fade> active;   // row major order
+    std::vector<mistake_fade> scratch;  // the previous set while resyncing
 };
 
 struct cell_change {
@@ -73,6 +156,11 @@ struct action {
 
 constexpr ImVec2 grid_size = {9, 9};
 
+// board sides the generator is asked for, anything past the max is a corrupt input rather than a
+// board anyone plays
+constexpr size_t BOARD_MIN_SIDE = 3;
+constexpr size_t BOARD_MAX_SIDE = 1024;
+
 struct Texture {
     SDL_Texture* tex = nullptr;
     float w = 0, h = 0;
@@ -114,21 +202,119 @@ inline Texture load_texture(const char* path, SDL_Renderer* renderer) {
     return t;
 }
 
-using kuromasu_grid = ktl::grid<cell /*, ktl::ArenaAllocator<cell>*/>;
+// the grids in state_t live on the heap, they are resized whenever the board changes size and an
+// arena never gives the old storage back. scratch_grid is for boards built inside an arena that
+// is reset afterwards, like generation's
+using kuromasu_grid = ktl::grid<cell>;
+using scratch_grid = ktl::grid<cell, ktl::ArenaAllocator<cell>>;
+
+// index into the row major side planes (mistakes, animations) kept next to a grid
+template <typename G>
+inline size_t cell_index(const G& g, ktl::pos2_size p) {
+    return p.y * g.width + p.x;
+}
+
+// scratch memory that is reset at the top of every SDL_AppIterate, nothing allocated from it may
+// outlive the frame
+extern ktl::Arena g_frame_arena;
 
-extern ktl::Arena g_arena;
-extern ktl::ArenaAllocator<cell> g_cell_alloc;
+template <typename T>
+using frame_vector = std::vector<T, ktl::ArenaAllocator<T>>;
+
+template <typename T>
+inline frame_vector<T> make_frame_vector() {
+    return frame_vector<T>(ktl::ArenaAllocator<T>(&g_frame_arena));
+}
+
+// uninitialised scratch for count values, never destroyed, so only for trivial types
+template <typename T>
+inline T* make_frame_array(size_t count) {
+    static_assert(std::is_trivially_destructible_v<T>);
+    return ktl::ArenaAllocator<T>(&g_frame_arena).allocate(count);
+}
+
+// formats into the frame arena, the string is gone with the frame and is never freed
+inline const char* frame_printf(SDL_PRINTF_FORMAT_STRING const char* fmt, ...)
+    SDL_PRINTF_VARARG_FUNC(1);
+
+inline const char* frame_printf(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int len = SDL_vsnprintf(nullptr, 0, fmt, args);
+    va_end(args);
+    if (len < 0) return "";
+
+    char* out = make_frame_array<char>((size_t)len + 1);
+    va_start(args, fmt);
+    SDL_vsnprintf(out, (size_t)len + 1, fmt, args);
+    va_end(args);
+    return out;
+}
+
+// window of deduction_difficulty() scores a board has to land in, see steer_difficulty()
+struct difficulty_band {
+    bool enabled = false;
+    float min = 1.0f;
+    float max = 1.4f;
+
+    bool operator==(const difficulty_band&) const = default;
+};
+
+struct generation_params {
+    size_t width = (size_t)grid_size.x;
+    size_t height = (size_t)grid_size.y;
+    float black_chance = 50.f;
+    float observer_chance = 50.f;
+    bool minimize = false;  // strip observers that follow from the others, see minimize_clues()
+    difficulty_band difficulty;  // takes over from `minimize` when enabled
+
+    bool operator==(const generation_params&) const = default;
+};
+
+// a fully generated board, independent of any state_t so it can be produced off the main thread,
+// the starting position is every observer as white and everything else blank. the solution is
+// a plain heap plane rather than an arena grid so it can be handed between threads freely
+struct puzzle_t {
+    generation_params params;
+    uint32_t seed = 0;
+
+    std::vector<cell> solution;  // row major, params.width * params.height
+    observer_table observers;
+
+    float difficulty = -1.0f;  // deduction_difficulty() score, only computed when targeted
+    // a band was targeted and every candidate was abandoned, the board is the last one as it is:
+    // outside the band and possibly in need of guessing
+    bool band_missed = false;
+};
+
+// an open instance of the embedded font at one size bucket, see get_font()
+struct font_slot {
+    int size = 0;
+    TTF_Font* font = nullptr;
+    uint64_t last_used = 0;
+};
+
+constexpr size_t FONT_CACHE_CAPACITY = 8;
+
+struct puzzle_queue;
+struct puzzle_pack;
+struct endless_world;
+struct text_cache;
+struct board_raster;
 
 struct state_t {
     kuromasu_grid game = kuromasu_grid(grid_size.x,
         grid_size.y,
-        // g_cell_alloc,
-        cell{.type = cell::blank, .observer_value = -1},
+        cell{.type = cell::blank},
         ktl::GRID_GROW_OUTWARD | ktl::GRID_NO_RETAIN_STATE);
 
     uint32_t seed = 0;
     float black_chance = 50.f;
     float observer_chance = 50.f;
+    bool minimize = false;
+    difficulty_band difficulty_target;
+    float difficulty = -1.0f;
+    bool band_missed = false;  // see puzzle_t
     float dt = 0;
     uint64_t prev_time = 0;
 
@@ -137,20 +323,42 @@ struct state_t {
 
     kuromasu_grid solved_state = kuromasu_grid(grid_size.x,
         grid_size.y,
-        // g_cell_alloc,
-        cell{.type = cell::blank, .observer_value = -1},
+        cell{.type = cell::blank},
         ktl::GRID_GROW_OUTWARD | ktl::GRID_NO_RETAIN_STATE);
     kuromasu_grid starting_pos = kuromasu_grid(grid_size.x,
         grid_size.y,
-        // g_cell_alloc,
-        cell{.type = cell::blank, .observer_value = -1},
+        cell{.type = cell::blank},
         ktl::GRID_GROW_OUTWARD | ktl::GRID_NO_RETAIN_STATE);
 
+    observer_table observers;
+    std::vector<uint8_t> mistakes;  // row major, written by solve()
+    uint64_t mistakes_version = 0;  // bumped every time mistakes is rewritten
+    uint64_t board_version = 0;     // bumped by apply_puzzle(), cell indices mean new cells
+    uint64_t hash = 0;              // board_hash() of game, updated with every cell_change
+
     ImVec2 offset;
     float cell_size;
 
-    std::unordered_map<int, TTF_Font*> fonts;
-    std::unordered_map<int64_t, Texture> font_texture_cache;
+    // zoom 1 fits the board into the game area, pan moves the board centre away from the centre
+    // of the area. camera_layout() turns it into offset, cell_size and the visible cell range
+    struct {
+        float zoom = 1.0f;
+        ImVec2 pan = {0, 0};
+        bool pinching = false;  // two fingers are down, they drive the camera instead of editing
+
+        ImVec2 origin = {0, 0};  // top left of the game area on screen
+        ImVec2 view = {0, 0};    // size of the game area
+        size_t board_w = 0;      // board size the camera was laid out for
+        size_t board_h = 0;
+
+        // cells at least partly on screen, x1 and y1 exclusive
+        size_t x0 = 0, y0 = 0;
+        size_t x1 = 0, y1 = 0;
+    } camera;
+
+    std::vector<font_slot> fonts;  // at most FONT_CACHE_CAPACITY
+    uint64_t font_clock = 0;
+    text_cache* text_textures = nullptr;
     Texture win_image;
 
 #if defined(__ANDROID__)
@@ -166,6 +374,13 @@ struct state_t {
     std::vector<action> undo_stack;
     std::vector<action> redo_stack;
 
+    puzzle_queue* queue = nullptr;
+
+    puzzle_pack* pack = nullptr;
+    size_t pack_index = 0;
+
+    endless_world* endless = nullptr;  // set while an endless board is played, see endless.h
+
     struct {
         ktl::pos2_size start = ktl::pos2_size::invalid();
         SDL_FRect rect = {-1, -1, -1, -1};
@@ -181,9 +396,16 @@ struct state_t {
     struct {
         ktl::pos2_size start = ktl::pos2_size::invalid();
         action drag_action;
+        bool cancelled = false;  // a pinch took the drag over, ignored until the next press
     } white_fill;
 };
 
+#if defined(__ANDROID__)
+constexpr bool IDLE_WHEN_STILL_DEFAULT = true;
+#else
+constexpr bool IDLE_WHEN_STILL_DEFAULT = false;
+#endif
+
 struct ctx_t {
     SDL_Window* window = nullptr;
     SDL_Renderer* renderer = nullptr;
@@ -192,8 +414,29 @@ struct ctx_t {
     state_t state;
 
     Texture game_tex;
+    mistake_fades fades;
+    bool idle_when_still = IDLE_WHEN_STILL_DEFAULT;  // see SDL_AppIterate
+    uint64_t last_event_ns = 0;
+
+    // one texel per cell, what draw_grid() shows once cells get too small for detail
+    struct {
+        Texture tex;
+        std::vector<uint32_t> texels;  // what the texture holds, row major
+        uint64_t hash = 0;             // board_hash() the texels were built from
+        bool valid = false;
+    } overview;
+
+    board_raster* raster = nullptr;  // see raster.h
+    const char* board_path = "";     // which way it drew the board
+    // flushes the renderer after draw_grid() and times it for the debug overlay. off by default,
+    // the flush breaks up the command batching of the gpu renderers
+    bool time_board = false;
+    float board_ms = 0.0f;  // how long the last timed draw_grid() took
 };
 
-TTF_Font* get_font(state_t& state, int size, const char* path = ASSET_DIR "Roboto-Regular.ttf");
+// Roboto from the blob linked into the binary at size rounded into a bucket, sizes past 16 are
+// rounded to within about 6% so a resize reuses a handful of instances. the least recently used
+// one is closed once FONT_CACHE_CAPACITY are open
+TTF_Font* get_font(state_t& state, int size);
 
 #endif /* COMMON_H */
@@ -0,0 +1,215 @@
+#include "connectivity.h"
+
+static void set_logged(white_connectivity& c, uint32_t& slot, uint32_t value) {
+    if (slot == value) return;
+    c.log.push_back({&slot, slot});
+    slot = value;
+}
+
+void connectivity_init(white_connectivity& c, size_t width, size_t height) {
+    size_t cells = width * height;
+
+    c.width = width;
+    c.height = height;
+
+    c.values.assign(cells, cell::blank);
+    c.parent.resize(cells);
+    c.size.assign(cells, 1);
+    c.open.assign(cells, 0);
+    for (size_t i = 0; i < cells; i++) {
+        c.parent[i] = (uint32_t)i;
+    }
+
+    c.whites = 0;
+    c.closed = 0;
+    c.closed_root = 0;
+    c.log.clear();
+    c.pushed.clear();
+    c.marks.clear();
+}
+
+uint32_t connectivity_find(const white_connectivity& c, uint32_t i) {
+    while (c.parent[i] != i) {
+        i = c.parent[i];
+    }
+    return i;
+}
+
+static void unite(white_connectivity& c, uint32_t a, uint32_t b) {
+    a = connectivity_find(c, a);
+    b = connectivity_find(c, b);
+    if (a == b) return;
+    if (c.size[a] < c.size[b]) std::swap(a, b);
+
+    set_logged(c, c.parent[b], a);
+    set_logged(c, c.size[a], c.size[a] + c.size[b]);
+    set_logged(c, c.open[a], c.open[a] + c.open[b]);
+}
+
+static void close_component(white_connectivity& c, uint32_t root) {
+    set_logged(c, c.closed, c.closed + 1);
+    set_logged(c, c.closed_root, root);
+}
+
+bool connectivity_push(white_connectivity& c, uint32_t index, cell::type_t value) {
+    c.marks.push_back((uint32_t)c.log.size());
+    c.pushed.push_back(index);
+    c.values[index] = value;
+
+    size_t x = index % c.width;
+    size_t y = index / c.width;
+    bool white = value == cell::white;
+
+    uint32_t neighbours[4];
+    int count = 0;
+    for (int dir = 0; dir < 4; dir++) {
+        size_t nx = x + ray_dx[dir];
+        size_t ny = y + ray_dy[dir];
+        if (nx >= c.width || ny >= c.height) continue;
+        neighbours[count++] = (uint32_t)(ny * c.width + nx);
+    }
+
+    // a white pushed after a component closed can never reach it
+    if (white && c.closed > 0) return false;
+
+    uint32_t blank = 0;
+    for (int k = 0; k < count; k++) {
+        uint32_t n = neighbours[k];
+        if (c.values[n] == cell::blank) blank++;
+        if (c.values[n] != cell::white) continue;
+
+        // the edge between n and this cell is no longer open. a white merges with n right
+        // after, so only a black can close the component here
+        uint32_t r = connectivity_find(c, n);
+        set_logged(c, c.open[r], c.open[r] - 1);
+        if (!white && c.open[r] == 0) close_component(c, r);
+    }
+
+    if (white) {
+        set_logged(c, c.whites, c.whites + 1);
+        set_logged(c, c.open[index], blank);
+
+        for (int k = 0; k < count; k++) {
+            if (c.values[neighbours[k]] == cell::white) unite(c, index, neighbours[k]);
+        }
+
+        uint32_t r = connectivity_find(c, index);
+        if (c.open[r] == 0) close_component(c, r);
+    }
+
+    if (c.closed == 0) return true;
+    if (c.closed > 1) return false;
+
+    // the one closed component has to hold every white
+    return c.size[c.closed_root] == c.whites;
+}
+
+void connectivity_pop(white_connectivity& c) {
+    uint32_t mark = c.marks.back();
+    c.marks.pop_back();
+
+    while (c.log.size() > mark) {
+        auto& e = c.log.back();
+        *e.slot = e.old;
+        c.log.pop_back();
+    }
+
+    c.values[c.pushed.back()] = cell::blank;
+    c.pushed.pop_back();
+}
+
+void scanline_init(scanline_connectivity& s, size_t width) {
+    s.width = width;
+    s.rows = 0;
+    s.above.assign(width, scanline_connectivity::NONE);
+    s.labels.assign(width, scanline_connectivity::NONE);
+    s.parent.resize(width * 2);
+    s.remap.assign(width * 2, scanline_connectivity::NONE);
+    s.white.assign(width * 2, 0);
+    s.above_white.assign(width, 0);
+    s.finished = 0;
+    s.current = 0;
+    s.blacks_touch = false;
+}
+
+static uint32_t scanline_find(scanline_connectivity& s, uint32_t i) {
+    while (s.parent[i] != i) {
+        s.parent[i] = s.parent[s.parent[i]];
+        i = s.parent[i];
+    }
+    return i;
+}
+
+void scanline_push(scanline_connectivity& s, const cell* row) {
+    constexpr uint32_t NONE = scanline_connectivity::NONE;
+    uint32_t w = (uint32_t)s.width;
+
+    // the row above keeps its labels as roots, the new row gets fresh ones from w up
+    for (uint32_t i = 0; i < 2 * w; i++) {
+        s.parent[i] = i;
+    }
+
+    for (uint32_t x = 0; x < w; x++) {
+        if (row[x].type == cell::black) {
+            s.labels[x] = NONE;
+            if (s.above[x] == NONE && s.rows > 0) s.blacks_touch = true;
+            if (x > 0 && row[x - 1].type == cell::black) s.blacks_touch = true;
+            continue;
+        }
+
+        // runs share the label of their first cell
+        s.labels[x] = x > 0 && s.labels[x - 1] != NONE ? s.labels[x - 1] : w + x;
+        if (s.above[x] != NONE) {
+            uint32_t a = scanline_find(s, s.above[x]);
+            uint32_t b = scanline_find(s, s.labels[x]);
+            if (a != b) s.parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    // whites are gathered on the roots once every merge is done
+    for (uint32_t i = 0; i < 2 * w; i++) {
+        s.white[i] = 0;
+    }
+    for (uint32_t i = 0; i < w; i++) {
+        if (s.above_white[i]) s.white[scanline_find(s, i)] = 1;
+    }
+    for (uint32_t x = 0; x < w; x++) {
+        if (row[x].type == cell::white) s.white[scanline_find(s, s.labels[x])] = 1;
+    }
+
+    // components of the row above that reach into this one, every other one just ended
+    for (uint32_t x = 0; x < w; x++) {
+        if (s.labels[x] != NONE) s.remap[scanline_find(s, s.labels[x])] = 0;
+    }
+    for (uint32_t x = 0; x < w; x++) {
+        if (s.above[x] == NONE) continue;
+        uint32_t r = scanline_find(s, s.above[x]);
+        if (s.remap[r] == NONE) {
+            if (s.white[r]) s.finished++;
+            s.remap[r] = 0;  // counted
+        }
+    }
+
+    // compact this row's components to 0..w-1, they become the roots of the next push
+    std::fill(s.remap.begin(), s.remap.end(), NONE);
+    uint32_t next = 0;
+    size_t with_white = 0;
+    for (uint32_t x = 0; x < w; x++) {
+        if (s.labels[x] == NONE) {
+            s.above[x] = NONE;
+            continue;
+        }
+
+        uint32_t r = scanline_find(s, s.labels[x]);
+        if (s.remap[r] == NONE) {
+            s.above_white[next] = s.white[r];
+            with_white += s.white[r];
+            s.remap[r] = next++;
+        }
+        s.above[x] = s.remap[r];
+    }
+    std::fill(s.remap.begin(), s.remap.end(), NONE);
+
+    s.current = with_white;
+    s.rows++;
+}
@@ -0,0 +1,82 @@
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include "common.h"
+
+// incremental "can the whites still be connected" check for backtracking searches. decided
+// whites are kept in a union-find, every component counts the edges from its cells to undecided
+// neighbours. a component whose count drops to zero is fenced in by blacks for good, once that
+// happens no white may exist outside of it. cells can be decided in any order, a search mirrors
+// its trail into it
+//
+// union by size without path compression, so a decision changes a handful of slots and every one
+// of them goes on an undo log. popping a decision restores exactly those slots, O(1) per undone
+// cell instead of a flood fill per search node
+
+struct white_connectivity {
+    size_t width = 0;
+    size_t height = 0;
+
+    std::vector<cell::type_t> values;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> size;  // per root, whites in the component
+    std::vector<uint32_t> open;  // per root, edges from its whites to undecided cells
+    uint32_t whites = 0;
+    uint32_t closed = 0;       // components with no open edge left
+    uint32_t closed_root = 0;  // root of the first one, its members never change after
+
+    struct undo_entry {
+        uint32_t* slot;
+        uint32_t old;
+    };
+    std::vector<undo_entry> log;
+    std::vector<uint32_t> pushed;  // decided cells, in order
+    std::vector<uint32_t> marks;   // log size before each of them
+};
+
+void connectivity_init(white_connectivity& c, size_t width, size_t height);
+
+uint32_t connectivity_find(const white_connectivity& c, uint32_t i);
+
+// decides a cell, false once the whites can no longer end up connected. the cell is pushed either
+// way, undo it with connectivity_pop()
+bool connectivity_push(white_connectivity& c, uint32_t index, cell::type_t value);
+void connectivity_pop(white_connectivity& c);
+
+inline size_t connectivity_depth(const white_connectivity& c) { return c.pushed.size(); }
+
+// one pass, row by row check for boards too big to hold in memory. only the labels of the last
+// row are kept, each new row is labelled by runs and merged with the row above in a union-find
+// over the two rows, then relabelled to 0..width-1 for the next one. a component of the row above
+// that nothing in the new row joins is finished, once one is finished every other white makes the
+// board disconnected. memory is O(width) whatever the height
+//
+// blanks count as cells that may still turn white, like step 3 of solve(), and only components
+// holding a white count. a pocket of blanks fenced in by blacks can simply stay black
+struct scanline_connectivity {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    size_t width = 0;
+    size_t rows = 0;
+
+    std::vector<uint32_t> above;   // component per column of the last row, NONE on black
+    std::vector<uint32_t> labels;  // same for the row being pushed, offset by width
+    std::vector<uint32_t> parent;  // union-find over both rows' labels
+    std::vector<uint32_t> remap;   // scratch, per root
+    std::vector<uint8_t> white;    // scratch, per root, whether the component holds a white
+    std::vector<uint8_t> above_white;  // per component of the last row
+
+    size_t finished = 0;  // components with a white that ended above the last row
+    size_t current = 0;   // components with a white in the last row
+    bool blacks_touch = false;
+};
+
+void scanline_init(scanline_connectivity& s, size_t width);
+void scanline_push(scanline_connectivity& s, const cell* row);
+
+// whether the whites pushed so far can still end up as one region, once false it stays false
+inline bool scanline_connected(const scanline_connectivity& s) {
+    return s.finished + s.current <= 1;
+}
+
+#endif /* CONNECTIVITY_H */
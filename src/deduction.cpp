@@ -0,0 +1,838 @@
+#include "deduction.h"
+#include <bit>
+#include "connectivity.h"
+#include "kernels.h"
+#include "rng.h"
+#include "zobrist.h"
+
+// count_solutions() results remembered per thread
+constexpr size_t COUNT_SOLUTIONS_MEMO = 4096;
+
+// trail entries with this bit set record a clue activation instead of a cell decision
+constexpr uint32_t TRAIL_CLUE_BIT = 0x80000000u;
+
+static void queue_clue(deduction_state& d, uint32_t id) {
+    if (!d.clues[id].active || d.clue_queued[id]) return;
+    d.clue_queued[id] = 1;
+    d.clue_queue.push_back(id);
+}
+
+static void clear_clue_queue(deduction_state& d) {
+    for (uint32_t id : d.clue_queue) {
+        d.clue_queued[id] = 0;
+    }
+    d.clue_queue.clear();
+}
+
+void deduction_init(deduction_state& d, size_t width, size_t height, const observer_table& obs) {
+    d.width = width;
+    d.height = height;
+
+    d.values.assign(width * height, cell::blank);
+    d.trail.clear();
+    d.trail_rule.clear();
+    d.propagated = 0;
+    std::fill(std::begin(d.rule_counts), std::end(d.rule_counts), 0);
+
+    d.clues.clear();
+    d.row_clues.assign(height, {});
+    d.col_clues.assign(width, {});
+    for (auto& o : obs) {
+        uint32_t id = (uint32_t)d.clues.size();
+        d.clues.push_back({.index = (uint32_t)(o.pos.y * width + o.pos.x), .value = o.value});
+        d.row_clues[o.pos.y].push_back(id);
+        d.col_clues[o.pos.x].push_back(id);
+    }
+
+    d.clue_queue.clear();
+    d.clue_queued.assign(d.clues.size(), 0);
+    d.connectivity = true;
+
+    d.stack.clear();
+    d.forced.clear();
+    d.disc.assign(width * height, 0);
+    d.low.assign(width * height, 0);
+    d.parent.assign(width * height, 0);
+    d.subtree_whites.assign(width * height, 0);
+    d.next_dir.assign(width * height, 0);
+}
+
+bool deduction_assign(deduction_state& d,
+    uint32_t index,
+    cell::type_t value,
+    deduction_rule rule) {
+    cell::type_t cur = d.values[index];
+    if (cur == value) return true;
+    if (cur != cell::blank) return false;
+
+    d.values[index] = value;
+    d.trail.push_back(index);
+    d.trail_rule.push_back(rule);
+    d.rule_counts[rule]++;
+    return true;
+}
+
+bool deduction_activate(deduction_state& d, uint32_t clue) {
+    auto& c = d.clues[clue];
+    if (!c.active) {
+        c.active = true;
+        d.trail.push_back(clue | TRAIL_CLUE_BIT);
+        d.trail_rule.push_back(RULE_GIVEN);
+    }
+
+    return deduction_assign(d, c.index, cell::white);
+}
+
+void deduction_rollback(deduction_state& d, size_t checkpoint) {
+    while (d.trail.size() > checkpoint) {
+        uint32_t e = d.trail.back();
+        uint8_t rule = d.trail_rule.back();
+        d.trail.pop_back();
+        d.trail_rule.pop_back();
+
+        if (e & TRAIL_CLUE_BIT) {
+            d.clues[e & ~TRAIL_CLUE_BIT].active = false;
+        } else {
+            d.values[e] = cell::blank;
+            d.rule_counts[rule]--;
+        }
+    }
+
+    d.propagated = std::min(d.propagated, checkpoint);
+    clear_clue_queue(d);
+}
+
+struct clue_bounds {
+    int min_d[4];  // whites seen for sure per direction
+    int max_d[4];  // whites seen at most per direction
+    int total_min = 1;
+    int total_max = 1;
+};
+
+static uint32_t ray_cell(const deduction_state& d, const deduction_clue& c, int dir, int dist) {
+    size_t x = c.index % d.width + ray_dx[dir] * dist;
+    size_t y = c.index / d.width + ray_dy[dir] * dist;
+    return (uint32_t)(y * d.width + x);
+}
+
+static clue_bounds measure_clue(const deduction_state& d, const deduction_clue& c) {
+    int w = (int)d.width;
+    int h = (int)d.height;
+    int x0 = (int)(c.index % d.width);
+    int y0 = (int)(c.index / d.width);
+
+    clue_bounds b;
+    for (int dir = 0; dir < 4; dir++) {
+        int n = 0;
+        int x = x0 + ray_dx[dir];
+        int y = y0 + ray_dy[dir];
+
+        while (x >= 0 && x < w && y >= 0 && y < h && d.values[y * w + x] == cell::white) {
+            n++;
+            x += ray_dx[dir];
+            y += ray_dy[dir];
+        }
+        b.min_d[dir] = n;
+
+        while (x >= 0 && x < w && y >= 0 && y < h && d.values[y * w + x] != cell::black) {
+            n++;
+            x += ray_dx[dir];
+            y += ray_dy[dir];
+        }
+        b.max_d[dir] = n;
+
+        b.total_min += b.min_d[dir];
+        b.total_max += b.max_d[dir];
+    }
+
+    return b;
+}
+
+static bool can_be_black(const deduction_state& d, uint32_t i) {
+    if (d.values[i] != cell::blank) return false;
+
+    size_t x = i % d.width;
+    size_t y = i / d.width;
+    for (int dir = 0; dir < 4; dir++) {
+        size_t nx = x + ray_dx[dir];
+        size_t ny = y + ray_dy[dir];
+        if (nx < d.width && ny < d.height && d.values[ny * d.width + nx] == cell::black) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// sums of every pair of lengths out of two sets, bit n set when n can be made
+static uint64_t add_lengths(uint64_t a, uint64_t b, uint64_t mask) {
+    uint64_t out = 0;
+    while (b) {
+        out |= a << std::countr_zero(b);
+        b &= b - 1;
+    }
+    return out & mask;
+}
+
+// exact form of the observer rule for clues up to 64. every direction keeps the set of lengths it
+// can still end up seeing: one that runs to the end of the ray, or one that stops in front of a
+// cell that can still turn black. a length only survives if the other three directions can make
+// up the rest of the clue, the shortest survivor is white for sure and a lone survivor is closed
+static bool apply_clue_lengths(deduction_state& d, const deduction_clue& c, const clue_bounds& b) {
+    int total = c.value - 1;  // without the observer itself
+    uint64_t mask = total == 63 ? ~0ull : (1ull << (total + 1)) - 1;
+
+    uint64_t lengths[4];
+    for (int dir = 0; dir < 4; dir++) {
+        uint64_t m = 0;
+        for (int len = b.min_d[dir]; len <= b.max_d[dir] && len <= total; len++) {
+            if (len == b.max_d[dir] || can_be_black(d, ray_cell(d, c, dir, len + 1))) {
+                m |= 1ull << len;
+            }
+        }
+        lengths[dir] = m;
+    }
+
+    uint64_t before[5];
+    uint64_t after[5];
+    before[0] = 1;
+    after[4] = 1;
+    for (int dir = 0; dir < 4; dir++) {
+        before[dir + 1] = add_lengths(before[dir], lengths[dir], mask);
+        after[3 - dir] = add_lengths(after[4 - dir], lengths[3 - dir], mask);
+    }
+
+    if (!((before[4] >> total) & 1)) return false;
+
+    for (int dir = 0; dir < 4; dir++) {
+        uint64_t others = add_lengths(before[dir], after[dir + 1], mask);
+
+        uint64_t supported = 0;
+        for (uint64_t m = lengths[dir]; m; m &= m - 1) {
+            int len = std::countr_zero(m);
+            if ((others >> (total - len)) & 1) supported |= 1ull << len;
+        }
+
+        if (!supported) return false;
+
+        int shortest = std::countr_zero(supported);
+        for (int s = b.min_d[dir] + 1; s <= shortest; s++) {
+            if (!deduction_assign(d, ray_cell(d, c, dir, s), cell::white, RULE_CLUE)) return false;
+        }
+
+        if (std::has_single_bit(supported) && shortest < b.max_d[dir]) {
+            uint32_t end = ray_cell(d, c, dir, shortest + 1);
+            if (!deduction_assign(d, end, cell::black, RULE_CLUE)) return false;
+        }
+    }
+
+    return true;
+}
+
+// min/max visibility bounds of a single observer, see the rules in deduction.h
+static bool apply_clue(deduction_state& d, const deduction_clue& c) {
+    clue_bounds b = measure_clue(d, c);
+    if (b.total_min > c.value || b.total_max < c.value) return false;
+    if (b.total_min == b.total_max) return true;  // every ray is closed already
+
+    if (c.value <= 64) return apply_clue_lengths(d, c, b);
+
+    for (int dir = 0; dir < 4; dir++) {
+        int min_d = b.min_d[dir];
+        int max_d = b.max_d[dir];
+
+        // whatever the other directions cannot see at most has to come from this one
+        int need = c.value - (b.total_max - max_d);
+        for (int s = min_d + 1; s <= need; s++) {
+            if (!deduction_assign(d, ray_cell(d, c, dir, s), cell::white, RULE_CLUE)) return false;
+        }
+
+        if (need > min_d || min_d == max_d) continue;
+
+        // the first undecided cell would join the whites behind it, black if that overshoots
+        int run = 0;
+        while (min_d + 2 + run <= max_d &&
+               d.values[ray_cell(d, c, dir, min_d + 2 + run)] == cell::white) {
+            run++;
+        }
+
+        if (b.total_min + 1 + run > c.value) {
+            uint32_t end = ray_cell(d, c, dir, min_d + 1);
+            if (!deduction_assign(d, end, cell::black, RULE_CLUE)) return false;
+        }
+    }
+
+    return true;
+}
+
+// every white has to reach every other one through non black cells. a depth first search over
+// the non black cells rooted at a white finds the articulation points on the way (Tarjan), an
+// undecided cell that is the only link between two groups of whites has to be white itself
+static bool apply_connectivity(deduction_state& d) {
+    size_t cells = d.values.size();
+
+    size_t total_whites = 0;
+    uint32_t root = UINT32_MAX;
+    for (size_t i = 0; i < cells; i++) {
+        if (d.values[i] != cell::white) continue;
+        if (root == UINT32_MAX) root = (uint32_t)i;
+        total_whites++;
+    }
+    if (root == UINT32_MAX) return true;
+
+    std::fill(d.disc.begin(), d.disc.end(), 0);
+    d.stack.clear();
+    d.forced.clear();
+
+    uint32_t timer = 0;
+    auto visit = [&](uint32_t v, uint32_t parent) {
+        d.disc[v] = d.low[v] = ++timer;
+        d.parent[v] = parent;
+        d.next_dir[v] = 0;
+        d.subtree_whites[v] = d.values[v] == cell::white;
+        d.stack.push_back(v);
+    };
+
+    visit(root, root);
+
+    while (!d.stack.empty()) {
+        uint32_t v = d.stack.back();
+
+        if (d.next_dir[v] < 4) {
+            int dir = d.next_dir[v]++;
+            size_t nx = v % d.width + ray_dx[dir];
+            size_t ny = v / d.width + ray_dy[dir];
+            if (nx >= d.width || ny >= d.height) continue;
+
+            uint32_t n = (uint32_t)(ny * d.width + nx);
+            if (d.values[n] == cell::black) continue;
+
+            if (!d.disc[n]) {
+                visit(n, v);
+            } else if (n != d.parent[v]) {
+                d.low[v] = std::min(d.low[v], d.disc[n]);
+            }
+            continue;
+        }
+
+        d.stack.pop_back();
+        if (v == root) break;
+
+        uint32_t p = d.parent[v];
+        d.low[p] = std::min(d.low[p], d.low[v]);
+        d.subtree_whites[p] += d.subtree_whites[v];
+
+        // p separates the whites below v from the root, which is white
+        if (d.low[v] >= d.disc[p] && d.subtree_whites[v] > 0 && d.values[p] == cell::blank) {
+            d.forced.push_back(p);
+        }
+    }
+
+    if (d.subtree_whites[root] != total_whites) return false;
+
+    for (uint32_t i : d.forced) {
+        deduction_assign(d, i, cell::white, RULE_CONNECTIVITY);
+    }
+
+    return true;
+}
+
+bool deduction_propagate(deduction_state& d) {
+    for (;;) {
+        while (d.propagated < d.trail.size()) {
+            uint32_t e = d.trail[d.propagated++];
+
+            if (e & TRAIL_CLUE_BIT) {
+                queue_clue(d, e & ~TRAIL_CLUE_BIT);
+                continue;
+            }
+
+            size_t x = e % d.width;
+            size_t y = e / d.width;
+
+            // a new black also changes which neighbouring cells can still turn black, so the
+            // lines next to it are woken up as well
+            bool black = d.values[e] == cell::black;
+            size_t y0 = black && y > 0 ? y - 1 : y;
+            size_t y1 = black && y + 1 < d.height ? y + 1 : y;
+            size_t x0 = black && x > 0 ? x - 1 : x;
+            size_t x1 = black && x + 1 < d.width ? x + 1 : x;
+
+            for (size_t row = y0; row <= y1; row++) {
+                for (uint32_t id : d.row_clues[row]) {
+                    queue_clue(d, id);
+                }
+            }
+            for (size_t col = x0; col <= x1; col++) {
+                for (uint32_t id : d.col_clues[col]) {
+                    queue_clue(d, id);
+                }
+            }
+
+            if (!black) continue;
+
+            for (int dir = 0; dir < 4; dir++) {
+                size_t nx = x + ray_dx[dir];
+                size_t ny = y + ray_dy[dir];
+                if (nx >= d.width || ny >= d.height) continue;
+
+                uint32_t n = (uint32_t)(ny * d.width + nx);
+                if (!deduction_assign(d, n, cell::white, RULE_NEIGHBOUR)) {
+                    clear_clue_queue(d);
+                    return false;
+                }
+            }
+        }
+
+        if (d.clue_queue.empty()) {
+            if (!d.connectivity) break;
+
+            size_t before = d.trail.size();
+            if (!apply_connectivity(d)) return false;
+            if (d.trail.size() == before) break;
+            continue;
+        }
+
+        uint32_t id = d.clue_queue.back();
+        d.clue_queue.pop_back();
+        d.clue_queued[id] = 0;
+
+        if (!apply_clue(d, d.clues[id])) {
+            clear_clue_queue(d);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool deduction_solved(deduction_state& d) {
+    if (!deduction_propagate(d)) return false;
+
+    for (auto v : d.values) {
+        if (v == cell::blank) return false;
+    }
+
+    return true;
+}
+
+// probes open cells until none of them settles any more, false only on a contradiction
+static bool probe_open_cells(deduction_state& d) {
+    if (!deduction_propagate(d)) return false;
+
+    for (;;) {
+        bool open = false;
+        bool progress = false;
+
+        for (uint32_t i = 0; i < d.values.size(); i++) {
+            if (d.values[i] != cell::blank) continue;
+            open = true;
+
+            for (cell::type_t value : {cell::black, cell::white}) {
+                size_t checkpoint = deduction_checkpoint(d);
+                bool possible = deduction_assign(d, i, value) && deduction_propagate(d);
+                deduction_rollback(d, checkpoint);
+
+                if (possible) continue;
+
+                cell::type_t other = value == cell::black ? cell::white : cell::black;
+                if (!deduction_assign(d, i, other, RULE_PROBE) || !deduction_propagate(d)) {
+                    return false;
+                }
+
+                progress = true;
+                break;
+            }
+        }
+
+        if (!open || !progress) return true;
+    }
+}
+
+bool deduction_solve(deduction_state& d) {
+    if (!probe_open_cells(d)) return false;
+
+    for (auto v : d.values) {
+        if (v == cell::blank) return false;
+    }
+
+    return true;
+}
+
+// the nearest open cell of the observer with the fewest open cells left in view. deciding one
+// observer's cells back to back lets a wrong guess fail right where it was made instead of many
+// levels further down. cells no observer sees go last, UINT32_MAX once every cell is decided
+static uint32_t pick_branch_cell(const deduction_state& d) {
+    uint32_t best = UINT32_MAX;
+    uint32_t best_open = UINT32_MAX;
+
+    for (auto& clue : d.clues) {
+        uint32_t open = 0;
+        uint32_t nearest = UINT32_MAX;
+        int nearest_dist = 0;
+
+        for (int dir = 0; dir < 4; dir++) {
+            for (int dist = 1;; dist++) {
+                size_t x = clue.index % d.width + ray_dx[dir] * dist;
+                size_t y = clue.index / d.width + ray_dy[dir] * dist;
+                if (x >= d.width || y >= d.height) break;
+
+                uint32_t i = (uint32_t)(y * d.width + x);
+                if (d.values[i] == cell::black) break;
+                if (d.values[i] != cell::blank) continue;
+
+                open++;
+                if (nearest == UINT32_MAX || dist < nearest_dist) {
+                    nearest_dist = dist;
+                    nearest = i;
+                }
+            }
+        }
+
+        if (open > 0 && open < best_open) {
+            best_open = open;
+            best = nearest;
+        }
+    }
+
+    if (best != UINT32_MAX) return best;
+
+    for (uint32_t i = 0; i < d.values.size(); i++) {
+        if (d.values[i] == cell::blank) return i;
+    }
+
+    return UINT32_MAX;
+}
+
+static size_t search_solutions(const puzzle_t& p, size_t limit) {
+    static thread_local deduction_state d;
+    static thread_local white_connectivity c;
+
+    size_t width = p.params.width;
+    size_t height = p.params.height;
+    size_t cells = width * height;
+
+    deduction_init(d, width, height, p.observers);
+    connectivity_init(c, width, height);
+
+    for (uint32_t id = 0; id < d.clues.size(); id++) {
+        if (!deduction_activate(d, id)) return 0;
+    }
+
+    // probing once up front, with the full connectivity rule, settles most of what would
+    // otherwise be rediscovered under every branch of the search
+    if (!probe_open_cells(d) || cells == 0) return 0;
+    d.connectivity = false;
+
+    // every cell decision on the trail is mirrored into the connectivity check
+    size_t synced = 0;
+    auto sync = [&]() -> bool {
+        while (synced < d.trail.size()) {
+            uint32_t e = d.trail[synced++];
+            if (e & TRAIL_CLUE_BIT) continue;
+            if (!connectivity_push(c, e, d.values[e])) return false;
+        }
+        return true;
+    };
+
+    if (!sync()) return 0;
+
+    uint32_t first = pick_branch_cell(d);
+    if (first == UINT32_MAX) return 1;
+
+    // one frame per branching cell, `next` counts the values tried there so far
+    struct frame {
+        size_t checkpoint;
+        size_t depth;
+        uint32_t index;
+        uint8_t next;
+    };
+    std::vector<frame> frames;
+    frames.reserve(cells);
+    frames.push_back({deduction_checkpoint(d), connectivity_depth(c), first, 0});
+
+    size_t solutions = 0;
+    while (!frames.empty()) {
+        frame& f = frames.back();
+
+        while (connectivity_depth(c) > f.depth) {
+            connectivity_pop(c);
+        }
+        deduction_rollback(d, f.checkpoint);
+        synced = f.checkpoint;
+
+        if (f.next == 2) {
+            frames.pop_back();
+            continue;
+        }
+
+        cell::type_t value = f.next++ == 0 ? cell::black : cell::white;
+        if (!deduction_assign(d, f.index, value) || !deduction_propagate(d) || !sync()) {
+            continue;
+        }
+
+        uint32_t next = pick_branch_cell(d);
+        if (next == UINT32_MAX) {
+            if (++solutions >= limit) break;
+            continue;
+        }
+
+        frames.push_back({deduction_checkpoint(d), connectivity_depth(c), next, 0});
+    }
+
+    return solutions;
+}
+
+size_t count_solutions(const puzzle_t& p, size_t limit) {
+    zone_scoped_n("count solutions");
+
+    // a depth first search never meets the same state twice, what repeats are whole queries:
+    // packs regenerating a board, batch runs retrying seeds. the answer only depends on the
+    // layout and the limit
+    static thread_local transposition_table memo;
+    if (memo.slots.empty()) tt_init(memo, COUNT_SOLUTIONS_MEMO);
+
+    uint64_t key = layout_hash(p) ^ splitmix64(limit);
+    uint32_t cached;
+    if (tt_find(memo, key, &cached)) return cached;
+
+    // the sizes with their own kernel settle most boards by propagation alone, only the ones it
+    // leaves undecided pay for the search
+    size_t solutions = SIZE_MAX;
+    if (has_size_kernel(p.params.width, p.params.height)) {
+        static thread_local std::vector<cell> decided;
+        switch (propagate_clues(p.params.width, p.params.height, p.observers, decided)) {
+            case kernel_result::SOLVED:
+                solutions = std::min(limit, (size_t)1);
+                break;
+            case kernel_result::CONTRADICTION:
+                solutions = 0;
+                break;
+            case kernel_result::STUCK:
+                break;
+        }
+    }
+    if (solutions == SIZE_MAX) solutions = search_solutions(p, limit);
+    tt_store(memo, key, (uint32_t)std::min(solutions, (size_t)UINT32_MAX));
+    return solutions;
+}
+
+float deduction_difficulty(const deduction_state& d) {
+    float weighted = 0.0f;
+    uint32_t decided = 0;
+
+    for (int r = RULE_NEIGHBOUR; r < RULE_COUNT; r++) {
+        weighted += rule_weight[r] * d.rule_counts[r];
+        decided += d.rule_counts[r];
+    }
+
+    return decided ? weighted / decided : 0.0f;
+}
+
+// decides the clues order[lo, hi) in order. on entry the state holds the kept clues before lo and
+// every clue from hi on, propagated. each half is tried on top of a state that already has the
+// other half's clues in it, so every level of the recursion propagates each clue once instead
+// of every trial re-propagating all clues behind it
+static void minimize_range(deduction_state& d,
+    const std::vector<uint32_t>& order,
+    size_t lo,
+    size_t hi,
+    std::vector<uint8_t>& removed) {
+    if (hi - lo == 1) {
+        if (deduction_solved(d)) removed[order[lo]] = 1;
+        return;
+    }
+
+    size_t mid = lo + (hi - lo) / 2;
+    size_t checkpoint = deduction_checkpoint(d);
+
+    // all of these are a subset of the full clue set, which is solvable, so none of them fail
+    for (size_t i = mid; i < hi; i++) {
+        deduction_activate(d, order[i]);
+    }
+    deduction_propagate(d);
+    minimize_range(d, order, lo, mid, removed);
+    deduction_rollback(d, checkpoint);
+
+    for (size_t i = lo; i < mid; i++) {
+        if (!removed[order[i]]) deduction_activate(d, order[i]);
+    }
+    deduction_propagate(d);
+    minimize_range(d, order, mid, hi, removed);
+    deduction_rollback(d, checkpoint);
+}
+
+size_t minimize_clues(puzzle_t& p) {
+    zone_scoped_n("minimize clues");
+
+    size_t n = p.observers.size();
+    if (n == 0) return 0;
+
+    // keeps its buffers from board to board
+    static thread_local deduction_state d;
+    deduction_init(d, p.params.width, p.params.height, p.observers);
+
+    for (uint32_t i = 0; i < n; i++) {
+        deduction_activate(d, i);
+    }
+    bool solvable = deduction_solved(d);
+    deduction_rollback(d, 0);
+
+    if (!solvable) return 0;
+
+    // removal order is drawn from the seed, so the same seed always keeps the same clues. each
+    // clue is dropped if the kept ones before it and all the ones after it still solve the board
+    counter_rng rng(p.seed);
+    std::vector<std::pair<uint32_t, uint32_t>> keys(n);
+    for (uint32_t i = 0; i < n; i++) {
+        keys[i] = {rng.u32(RNG_STREAM_MINIMIZE, i), i};
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = keys[i].second;
+    }
+
+    std::vector<uint8_t> removed(n, 0);
+    minimize_range(d, order, 0, n, removed);
+
+    size_t out = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!removed[i]) p.observers[out++] = p.observers[i];
+    }
+    p.observers.resize(out);
+
+    zone_text("%zu of %zu observers removed", n - out, n);
+
+    return n - out;
+}
+
+// value a clue at (x, y) would have on the solved board
+static int solution_visible(const puzzle_t& p, size_t x, size_t y) {
+    int visible = 1;
+    for (int dir = 0; dir < 4; dir++) {
+        size_t cx = x + ray_dx[dir];
+        size_t cy = y + ray_dy[dir];
+        while (cx < p.params.width && cy < p.params.height &&
+               p.solution[cy * p.params.width + cx].type == cell::white) {
+            visible++;
+            cx += ray_dx[dir];
+            cy += ray_dy[dir];
+        }
+    }
+    return visible;
+}
+
+// solves the board with its current clues, -1 if it cannot be done without guessing. the state
+// is left as the solve ended, decided or stuck
+static float evaluate_difficulty(deduction_state& d, const puzzle_t& p) {
+    deduction_init(d, p.params.width, p.params.height, p.observers);
+    for (uint32_t i = 0; i < p.observers.size(); i++) {
+        deduction_activate(d, i);
+    }
+
+    if (!deduction_solve(d)) return -1.0f;
+    return deduction_difficulty(d);
+}
+
+// the next clue to add: a white cell the solve got stuck on, or failing that one it could only
+// settle by probing or through connectivity. ties are broken by the seed
+static uint32_t pick_clue_to_add(const deduction_state& d,
+    const puzzle_t& p,
+    const counter_rng& rng,
+    uint64_t step) {
+    size_t cells = d.values.size();
+    std::vector<uint8_t> hard(cells, 0);
+
+    bool stuck = false;
+    for (size_t i = 0; i < cells; i++) {
+        if (d.values[i] == cell::blank) {
+            hard[i] = 1;
+            stuck = true;
+        }
+    }
+
+    if (!stuck) {
+        for (size_t t = 0; t < d.trail.size(); t++) {
+            if (d.trail[t] & TRAIL_CLUE_BIT) continue;
+            if (d.trail_rule[t] >= RULE_CONNECTIVITY) hard[d.trail[t]] = 1;
+        }
+    }
+
+    uint32_t best = UINT32_MAX;
+    uint32_t best_key = 0;
+    for (size_t i = 0; i < cells; i++) {
+        if (!hard[i] || p.solution[i].type != cell::white) continue;
+        if (is_observer(p.observers, {i % p.params.width, i / p.params.width})) continue;
+
+        uint32_t key = rng.u32(RNG_STREAM_DIFFICULTY, step * cells + i);
+        if (best == UINT32_MAX || key < best_key) {
+            best = (uint32_t)i;
+            best_key = key;
+        }
+    }
+
+    return best;
+}
+
+bool steer_difficulty(puzzle_t& p, const difficulty_band& band, uint32_t seed) {
+    zone_scoped_n("steer difficulty");
+
+    size_t w = p.params.width;
+    size_t cells = w * p.params.height;
+
+    static thread_local deduction_state d;
+    counter_rng rng(seed);
+
+    float score = evaluate_difficulty(d, p);
+
+    // 1. too hard or not solvable without guessing, add clues where the solve struggled. every
+    // added clue is a new observer, so this ends after at most one step per cell
+    for (uint64_t step = 0; score < 0.0f || score > band.max; step++) {
+        uint32_t i = pick_clue_to_add(d, p, rng, step);
+        if (i == UINT32_MAX) return false;
+
+        ktl::pos2_size pos = {i % w, i / w};
+        p.observers.push_back({.pos = pos, .value = solution_visible(p, pos.x, pos.y)});
+        index_observers(p.observers, w, p.params.height);
+
+        score = evaluate_difficulty(d, p);
+    }
+
+    // 2. too easy, take clues away in seeded order. a removal that needs guessing or overshoots
+    // the band is put back, running out of clues to try means the band is out of reach
+    if (score < band.min) {
+        // keyed past every index the growing steps can use
+        std::vector<std::pair<uint32_t, uint32_t>> order;
+        order.reserve(p.observers.size());
+        for (auto& o : p.observers) {
+            uint32_t i = (uint32_t)(o.pos.y * w + o.pos.x);
+            order.push_back({rng.u32(RNG_STREAM_DIFFICULTY, (uint64_t)cells * cells + i), i});
+        }
+        std::sort(order.begin(), order.end());
+
+        for (auto& [key, i] : order) {
+            ktl::pos2_size pos = {i % w, i / w};
+            observer* o = find_observer(p.observers, pos);
+            observer removed = *o;
+            p.observers.erase(p.observers.begin() + (o - p.observers.data()));
+
+            float trimmed = evaluate_difficulty(d, p);
+            if (trimmed < 0.0f || trimmed > band.max) {
+                p.observers.insert(
+                    std::lower_bound(p.observers.begin(), p.observers.end(), pos, observer_before),
+                    removed);
+                continue;
+            }
+
+            score = trimmed;
+            if (score >= band.min) break;
+        }
+
+        if (score < band.min) return false;
+    }
+
+    p.difficulty = score;
+    return true;
+}
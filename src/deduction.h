@@ -0,0 +1,113 @@
+#ifndef DEDUCTION_H
+#define DEDUCTION_H
+
+#include "common.h"
+
+// a propagating kuromasu solver used by the generator to reason about clue sets. it works on
+// flat cell indices, `blank` meaning undecided, and records every decision on a trail so any
+// state can be rolled back to a checkpoint instead of being rebuilt
+//
+// propagation rules:
+//   - a black cell forces its orthogonal neighbours white
+//   - an observer keeps, per direction, the lengths it can still see there. lengths the other
+//     directions cannot complete to its value are dropped, the shortest left is white for sure
+//     and a single one left is closed off with a black
+//   - every white has to be reachable from every other white through non black cells, an
+//     undecided cell that is the only link between whites is white
+
+// what decided a cell, in rising order of how hard the step is for a person
+enum deduction_rule : uint8_t {
+    RULE_GIVEN,         // observers and outside decisions
+    RULE_NEIGHBOUR,     // next to a black
+    RULE_CLUE,          // observer lengths
+    RULE_CONNECTIVITY,  // only link between whites
+    RULE_PROBE,         // the other value runs into a contradiction
+    RULE_COUNT,
+};
+
+// how much a single cell decided by each rule weighs into the difficulty score
+constexpr float rule_weight[RULE_COUNT] = {0.0f, 0.5f, 1.0f, 3.0f, 8.0f};
+
+struct deduction_clue {
+    uint32_t index = 0;  // cell
+    int value = 0;
+    bool active = false;
+};
+
+struct deduction_state {
+    size_t width = 0;
+    size_t height = 0;
+
+    std::vector<cell::type_t> values;
+    std::vector<uint32_t> trail;
+    std::vector<uint8_t> trail_rule;  // deduction_rule per trail entry
+    size_t propagated = 0;            // trail entries whose consequences have been queued
+    uint32_t rule_counts[RULE_COUNT] = {};  // cells currently decided by each rule
+
+    std::vector<deduction_clue> clues;
+    std::vector<std::vector<uint32_t>> row_clues;  // clue ids per row
+    std::vector<std::vector<uint32_t>> col_clues;  // clue ids per column
+
+    std::vector<uint32_t> clue_queue;
+    std::vector<uint8_t> clue_queued;
+
+    // run the articulation pass in deduction_propagate(), a search that keeps track of
+    // connectivity on its own turns it off
+    bool connectivity = true;
+
+    // connectivity scratch
+    std::vector<uint32_t> stack;
+    std::vector<uint32_t> forced;
+    std::vector<uint32_t> disc;
+    std::vector<uint32_t> low;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> subtree_whites;
+    std::vector<uint8_t> next_dir;
+};
+
+// sets up an empty board with every observer as an inactive clue, clue ids follow the table
+void deduction_init(deduction_state& d, size_t width, size_t height, const observer_table& obs);
+
+// decisions only, nothing is propagated until deduction_propagate()
+bool deduction_assign(deduction_state& d,
+    uint32_t index,
+    cell::type_t value,
+    deduction_rule rule = RULE_GIVEN);
+bool deduction_activate(deduction_state& d, uint32_t clue);
+
+// runs every rule to a fixed point, false on a contradiction
+bool deduction_propagate(deduction_state& d);
+
+inline size_t deduction_checkpoint(const deduction_state& d) { return d.trail.size(); }
+void deduction_rollback(deduction_state& d, size_t checkpoint);
+
+// propagates and reports whether that alone decided every cell. a board that passes has exactly
+// one solution and can be solved without guessing
+bool deduction_solved(deduction_state& d);
+
+// like deduction_solved(), but when propagation stalls every open cell is probed with both values
+// and one that leads to a contradiction settles it the other way
+bool deduction_solve(deduction_state& d);
+
+// counts the solutions of a clue set up to limit. square boards with a size kernel first go through
+// propagate_clues(), the rest and whatever it leaves undecided go to a backtracking search. every
+// node propagates the neighbour and observer rules, connectivity is checked incrementally by a
+// white_connectivity that mirrors the trail and is rolled back alongside it
+size_t count_solutions(const puzzle_t& p, size_t limit = 2);
+
+// rule weighted average over every cell that was not given, 0.5 (only neighbour steps) up to
+// 8 (only probing). meaningful once the state is solved
+float deduction_difficulty(const deduction_state& d);
+
+// drops observers whose clue follows from the others, as long as deduction_solved() still holds
+// for what is left. leaves the puzzle alone if the full clue set does not pass to begin with,
+// returns the number of observers removed
+size_t minimize_clues(puzzle_t& p);
+
+// turns a generated candidate into one whose difficulty lies inside the band. a board that is too
+// hard (or needs guessing) gets clues added where the solve had to probe or got stuck, one that
+// is too easy has clues taken away as long as it stays solvable and under the upper bound. gives
+// up as soon as neither direction can make progress, false means the candidate is abandoned
+bool steer_difficulty(puzzle_t& p, const difficulty_band& band, uint32_t seed);
+
+#endif /* DEDUCTION_H */
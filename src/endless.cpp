@@ -0,0 +1,362 @@
+#include "endless.h"
+#include "kuromasu.h"
+#include "rng.h"
+#include "zobrist.h"
+
+// a tile is built from a scratch area around it: its blacks need every observer up to a ray away,
+// those need the blacks up to another ray away, and those their candidate neighbours
+constexpr int32_t ENDLESS_APRON = 2 * ENDLESS_MAX_RAY + 1;
+constexpr int32_t ENDLESS_SCRATCH = ENDLESS_TILE + 2 * ENDLESS_APRON;
+
+static int32_t floor_div(int32_t a, int32_t b) {
+    return a / b - (int32_t)(a % b != 0 && (a < 0) != (b < 0));
+}
+
+static uint64_t tile_key(int32_t x, int32_t y) {
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+// cells are drawn by position rather than by index, so every tile sees the same draws
+static uint64_t world_index(int32_t x, int32_t y) { return splitmix64(tile_key(x, y)); }
+
+static void build_tile(const endless_world& w, endless_tile& t) {
+    zone_scoped_n("build tile");
+
+    constexpr int32_t S = ENDLESS_SCRATCH;
+    constexpr int32_t R = ENDLESS_MAX_RAY;
+    constexpr uint64_t NONE = UINT64_MAX;
+
+    static thread_local std::vector<uint64_t> draw;  // black candidates, NONE for the rest
+    static thread_local std::vector<uint8_t> black;  // before unseen ones are dropped
+    static thread_local std::vector<int16_t> clue;
+
+    int32_t ox = t.x * ENDLESS_TILE - ENDLESS_APRON;
+    int32_t oy = t.y * ENDLESS_TILE - ENDLESS_APRON;
+    counter_rng rng(w.seed);
+    uint64_t black_threshold = chance_threshold(w.black_chance);
+    uint64_t observer_threshold = chance_threshold(w.observer_chance);
+
+    draw.assign((size_t)S * S, NONE);
+    for (int32_t sy = 0; sy < S; sy++) {
+        for (int32_t sx = 0; sx < S; sx++) {
+            uint64_t v = rng.u32(RNG_STREAM_BLACK, world_index(ox + sx, oy + sy));
+            if (v < black_threshold) draw[sy * S + sx] = v;
+        }
+    }
+
+    // a candidate wins when no candidate around it drew lower, ties go to the earlier cell
+    black.assign((size_t)S * S, 0);
+    for (int32_t sy = 1; sy < S - 1; sy++) {
+        for (int32_t sx = 1; sx < S - 1; sx++) {
+            int32_t i = sy * S + sx;
+            if (draw[i] == NONE) continue;
+
+            bool lowest = true;
+            for (int32_t dy = -1; dy <= 1; dy++) {
+                for (int32_t dx = -1; dx <= 1; dx++) {
+                    int32_t j = i + dy * S + dx;
+                    if (j != i && (draw[j] < draw[i] || (draw[j] == draw[i] && j < i))) {
+                        lowest = false;
+                    }
+                }
+            }
+            black[i] = lowest;
+        }
+    }
+
+    // whites from i to the nearest black along d, -1 when there is none within a ray
+    auto run = [&](int32_t i, int d) -> int32_t {
+        int32_t step = ray_dx[d] + ray_dy[d] * S;
+        for (int32_t k = 1; k <= R; k++) {
+            if (black[i + step * k]) return k - 1;
+        }
+        return -1;
+    };
+
+    clue.assign((size_t)S * S, -1);
+    for (int32_t sy = ENDLESS_APRON - R; sy < ENDLESS_APRON + ENDLESS_TILE + R; sy++) {
+        for (int32_t sx = ENDLESS_APRON - R; sx < ENDLESS_APRON + ENDLESS_TILE + R; sx++) {
+            int32_t i = sy * S + sx;
+            if (black[i]) continue;
+            if (rng.u32(RNG_STREAM_OBSERVER, world_index(ox + sx, oy + sy)) >= observer_threshold) {
+                continue;
+            }
+
+            int32_t value = 1;
+            for (int d = 0; d < 4 && value > 0; d++) {
+                int32_t r = run(i, d);
+                value = r < 0 ? -1 : value + r;
+            }
+            clue[i] = (int16_t)value;
+        }
+    }
+
+    for (int32_t y = 0; y < ENDLESS_TILE; y++) {
+        for (int32_t x = 0; x < ENDLESS_TILE; x++) {
+            int32_t i = (ENDLESS_APRON + y) * S + ENDLESS_APRON + x;
+            size_t local = (size_t)(y * ENDLESS_TILE + x);
+
+            // a black stays only where some observer's ray ends on it
+            bool seen = false;
+            for (int d = 0; d < 4 && black[i] && !seen; d++) {
+                int32_t step = ray_dx[d] + ray_dy[d] * S;
+                for (int32_t k = 1; k <= R && !black[i + step * k]; k++) {
+                    if (clue[i + step * k] >= 0) {
+                        seen = true;
+                        break;
+                    }
+                }
+            }
+
+            t.solution[local] = seen ? cell::black : cell::white;
+            t.clues[local] = clue[i];
+            t.marks[local] = cell::blank;
+        }
+    }
+}
+
+static std::string tile_path(const endless_world& w, const endless_tile& t) {
+    return w.cache_dir + std::to_string(t.x) + "_" + std::to_string(t.y) + ".tile";
+}
+
+static void save_tile(const endless_world& w, endless_tile& t) {
+    if (!t.dirty || w.cache_dir.empty()) return;
+
+    uint8_t packed[ENDLESS_TILE_CELLS / 4] = {};
+    for (size_t i = 0; i < ENDLESS_TILE_CELLS; i++) {
+        packed[i / 4] |= (uint8_t)(t.marks[i] << (i % 4 * 2));
+    }
+
+    std::string path = tile_path(w, t);
+    SDL_IOStream* io = SDL_IOFromFile(path.c_str(), "wb");
+    if (!io) {
+        SDL_Log("Failed to save tile %s: %s", path.c_str(), SDL_GetError());
+        return;
+    }
+
+    bool ok = SDL_WriteU32LE(io, KUROMASU_TILE_MAGIC) &&
+              SDL_WriteU16LE(io, KUROMASU_TILE_VERSION) &&
+              SDL_WriteU16LE(io, (uint16_t)ENDLESS_TILE) &&
+              SDL_WriteIO(io, packed, sizeof(packed)) == sizeof(packed);
+    ok = SDL_CloseIO(io) && ok;
+
+    if (!ok) {
+        SDL_Log("Failed to save tile %s: %s", path.c_str(), SDL_GetError());
+        return;
+    }
+    t.dirty = false;
+}
+
+// false when the tile was never saved, or the file is not one this build wrote
+static bool load_tile_marks(const endless_world& w, endless_tile& t) {
+    if (w.cache_dir.empty()) return false;
+
+    std::string path = tile_path(w, t);
+    SDL_IOStream* io = SDL_IOFromFile(path.c_str(), "rb");
+    if (!io) return false;
+
+    uint32_t magic = 0;
+    uint16_t version = 0, size = 0;
+    uint8_t packed[ENDLESS_TILE_CELLS / 4];
+    bool ok = SDL_ReadU32LE(io, &magic) && SDL_ReadU16LE(io, &version) &&
+              SDL_ReadU16LE(io, &size) && SDL_ReadIO(io, packed, sizeof(packed)) == sizeof(packed);
+    SDL_CloseIO(io);
+
+    if (!ok || magic != KUROMASU_TILE_MAGIC || version > KUROMASU_TILE_VERSION ||
+        size != ENDLESS_TILE) {
+        SDL_Log("Ignoring unreadable tile %s", path.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < ENDLESS_TILE_CELLS; i++) {
+        uint8_t v = (packed[i / 4] >> (i % 4 * 2)) & 3;
+        t.marks[i] = v <= cell::white ? (cell::type_t)v : cell::blank;
+    }
+    return true;
+}
+
+static endless_tile& get_tile(endless_world& w, int32_t tx, int32_t ty) {
+    auto [it, inserted] = w.tiles.try_emplace(tile_key(tx, ty));
+    endless_tile& t = it->second;
+
+    if (inserted) {
+        t.x = tx;
+        t.y = ty;
+        build_tile(w, t);
+        w.built++;
+        if (load_tile_marks(w, t)) w.restored++;
+    }
+    return t;
+}
+
+// tile and index inside it of a world cell
+static std::pair<endless_tile*, size_t> world_cell(endless_world& w, int32_t x, int32_t y) {
+    int32_t tx = floor_div(x, ENDLESS_TILE);
+    int32_t ty = floor_div(y, ENDLESS_TILE);
+    endless_tile& t = get_tile(w, tx, ty);
+    return {&t, (size_t)((y - ty * ENDLESS_TILE) * ENDLESS_TILE + (x - tx * ENDLESS_TILE))};
+}
+
+static void store_window(endless_world& w, state_t& s) {
+    for (size_t y = 0; y < w.height; y++) {
+        for (size_t x = 0; x < w.width; x++) {
+            // observers and givens are only fixed for this window, they are not the player's
+            if (s.starting_pos.at(x, y).type != cell::blank) continue;
+
+            auto [t, i] = world_cell(w, w.x + (int32_t)x, w.y + (int32_t)y);
+            cell::type_t type = s.game.at(x, y).type;
+            if (t->marks[i] == type) continue;
+
+            t->marks[i] = type;
+            t->dirty = true;
+        }
+    }
+}
+
+static void evict_far_tiles(endless_world& w) {
+    int32_t x0 = floor_div(w.x, ENDLESS_TILE) - ENDLESS_KEEP_MARGIN;
+    int32_t y0 = floor_div(w.y, ENDLESS_TILE) - ENDLESS_KEEP_MARGIN;
+    int32_t x1 = floor_div(w.x + (int32_t)w.width - 1, ENDLESS_TILE) + ENDLESS_KEEP_MARGIN;
+    int32_t y1 = floor_div(w.y + (int32_t)w.height - 1, ENDLESS_TILE) + ENDLESS_KEEP_MARGIN;
+
+    for (auto it = w.tiles.begin(); it != w.tiles.end();) {
+        endless_tile& t = it->second;
+        if (t.x >= x0 && t.x <= x1 && t.y >= y0 && t.y <= y1) {
+            ++it;
+            continue;
+        }
+
+        save_tile(w, t);
+        w.evicted++;
+        it = w.tiles.erase(it);
+    }
+}
+
+static void show_window(endless_world& w, state_t& s) {
+    puzzle_t p;
+    p.params = {
+        .width = w.width,
+        .height = w.height,
+        .black_chance = w.black_chance,
+        .observer_chance = w.observer_chance,
+    };
+    p.seed = w.seed;
+    p.solution.resize(w.width * w.height);
+
+    std::vector<int16_t> clues(w.width * w.height);
+    for (size_t y = 0; y < w.height; y++) {
+        for (size_t x = 0; x < w.width; x++) {
+            auto [t, i] = world_cell(w, w.x + (int32_t)x, w.y + (int32_t)y);
+            p.solution[y * w.width + x].type = t->solution[i];
+            clues[y * w.width + x] = t->clues[i];
+        }
+    }
+
+    // only observers whose every ray ends on a black inside the window, the others count cells
+    // the player can't see and solve() would treat the window edge as the end of their rays
+    std::vector<uint8_t> seen(w.width * w.height);  // blacks a shown observer's ray ends on
+    for (size_t y = 0; y < w.height; y++) {
+        for (size_t x = 0; x < w.width; x++) {
+            int16_t value = clues[y * w.width + x];
+            if (value < 0) continue;
+
+            bool closed = true;
+            size_t ends[4];
+            for (int d = 0; d < 4 && closed; d++) {
+                size_t cx = x + ray_dx[d], cy = y + ray_dy[d];
+                while (cx < w.width && cy < w.height &&
+                       p.solution[cy * w.width + cx].type != cell::black) {
+                    cx += ray_dx[d];
+                    cy += ray_dy[d];
+                }
+                closed = cx < w.width && cy < w.height;
+                ends[d] = cy * w.width + cx;
+            }
+            if (!closed) continue;
+
+            p.observers.push_back({.pos = {x, y}, .value = value});
+            for (size_t e : ends) {
+                seen[e] = 1;
+            }
+        }
+    }
+    index_observers(p.observers, w.width, w.height);
+
+    apply_puzzle(s, p);
+
+    // a black only hidden observers end on can't be deduced inside the window, it is given
+    for (size_t y = 0; y < w.height; y++) {
+        for (size_t x = 0; x < w.width; x++) {
+            size_t i = y * w.width + x;
+            if (p.solution[i].type == cell::black && !seen[i]) {
+                s.starting_pos.at(x, y).type = cell::black;
+            }
+        }
+    }
+    s.game = s.starting_pos;
+
+    // the player's marks go on top of the starting position
+    for (size_t y = 0; y < w.height; y++) {
+        for (size_t x = 0; x < w.width; x++) {
+            if (s.starting_pos.at(x, y).type != cell::blank) continue;
+            auto [t, i] = world_cell(w, w.x + (int32_t)x, w.y + (int32_t)y);
+            s.game.at(x, y).type = t->marks[i];
+        }
+    }
+    s.hash = board_hash(s.game, s.observers);
+    solve(s);
+}
+
+endless_world* endless_create(uint32_t seed,
+    float black_chance,
+    float observer_chance,
+    size_t width,
+    size_t height) {
+    auto* w = new endless_world();
+    w->seed = seed;
+    w->black_chance = black_chance;
+    w->observer_chance = observer_chance;
+    w->width = width;
+    w->height = height;
+
+    char* pref = SDL_GetPrefPath("kociumba", "kuromasu");
+    if (pref) {
+        w->cache_dir = std::string(pref) + "endless/" + std::to_string(seed) + "/";
+        SDL_free(pref);
+
+        if (!SDL_CreateDirectory(w->cache_dir.c_str())) {
+            SDL_Log("Failed to create tile cache %s: %s", w->cache_dir.c_str(), SDL_GetError());
+            w->cache_dir.clear();
+        }
+    } else {
+        SDL_Log("No preferences path, endless progress will not be kept: %s", SDL_GetError());
+    }
+
+    return w;
+}
+
+void endless_destroy(state_t& s) {
+    if (!s.endless) return;
+
+    endless_world& w = *s.endless;
+    if (w.shown) store_window(w, s);
+    for (auto& [key, t] : w.tiles) {
+        save_tile(w, t);
+    }
+
+    delete s.endless;
+    s.endless = nullptr;
+}
+
+void endless_move(state_t& s, int32_t x, int32_t y) {
+    zone_scoped_n("endless move");
+
+    endless_world& w = *s.endless;
+    if (w.shown) store_window(w, s);
+
+    w.x = x;
+    w.y = y;
+    evict_far_tiles(w);
+    show_window(w, s);
+    w.shown = true;
+}
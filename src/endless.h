@@ -0,0 +1,77 @@
+#ifndef ENDLESS_H
+#define ENDLESS_H
+
+#include "common.h"
+
+#include <array>
+#include <string>
+
+// endless mode: an unbounded board cut into ENDLESS_TILE square tiles that only exist while they
+// are near the part being played. everything the generator decides about a cell is a pure
+// function of the world seed and the cell's world position, so a tile can be rebuilt at any time
+// and neighbouring tiles agree on their shared border without ever being generated together:
+//  - every cell draws whether it is a black candidate, a candidate stays black when its draw is
+//    the lowest of the candidates around it. blacks then never touch, not even diagonally, which
+//    also keeps every white connected to every other without a global check
+//  - observers are drawn per cell and count along that layout, one whose rays do not all end on a
+//    black within ENDLESS_MAX_RAY cells is not placed
+//  - a black no observer ray ends on is dropped like in generate_puzzle(), no ray changes by it
+//
+// the player plays a window of the world the size of the board. only the tiles under the window
+// and a margin around it are resident, a tile that falls out of it is dropped and the marks the
+// player made in it go to a small file (2 bits a cell) that is read back when it is built again.
+// memory and generation work follow the window, not how much of the world was visited. blacks
+// that only observers hidden by the window edge end on are given in the starting position
+
+constexpr int32_t ENDLESS_TILE = 16;
+constexpr size_t ENDLESS_TILE_CELLS = (size_t)ENDLESS_TILE * ENDLESS_TILE;
+constexpr int32_t ENDLESS_MAX_RAY = 24;
+constexpr int32_t ENDLESS_KEEP_MARGIN = 1;  // tiles kept around the ones under the window
+
+#define KUROMASU_TILE_VERSION 1
+#define KUROMASU_TILE_MAGIC 0x4c49544bu  // "KTIL"
+
+struct endless_tile {
+    int32_t x = 0;  // in tiles
+    int32_t y = 0;
+
+    std::array<cell::type_t, ENDLESS_TILE_CELLS> solution;
+    std::array<int16_t, ENDLESS_TILE_CELLS> clues;  // observer value, -1 for none
+    std::array<cell::type_t, ENDLESS_TILE_CELLS> marks;
+    bool dirty = false;  // marks differ from what is on disk
+};
+
+struct endless_world {
+    uint32_t seed = 0;
+    float black_chance = 50.f;
+    float observer_chance = 50.f;
+
+    // window, x and y are the world position of its top left cell
+    int32_t x = 0;
+    int32_t y = 0;
+    size_t width = 0;
+    size_t height = 0;
+    bool shown = false;  // the window is what state_t currently holds
+
+    std::unordered_map<uint64_t, endless_tile> tiles;
+    std::string cache_dir;  // empty when tiles can't be saved
+
+    uint64_t built = 0;
+    uint64_t restored = 0;  // built tiles that had marks on disk
+    uint64_t evicted = 0;
+};
+
+endless_world* endless_create(uint32_t seed,
+    float black_chance,
+    float observer_chance,
+    size_t width,
+    size_t height);
+
+// saves the marks of every resident tile and leaves endless mode
+void endless_destroy(state_t& s);
+
+// keeps the marks of the current window and replaces the board with the window at (x, y). the
+// undo history does not carry over
+void endless_move(state_t& s, int32_t x, int32_t y);
+
+#endif /* ENDLESS_H */
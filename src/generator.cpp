@@ -1,11 +1,16 @@
 #include "kuromasu.h"
+#include <atomic>
+#include "bitboard.h"
+#include "deduction.h"
+#include "rng.h"
+#include "zobrist.h"
 
-size_t raycast_direction_white(state_t& s, ktl::pos2_size p, size_t dx, size_t dy) {
+size_t raycast_direction_white(scratch_grid& g, ktl::pos2_size p, size_t dx, size_t dy) {
     size_t count = 0;
     int cx = (int)p.x + dx;
     int cy = (int)p.y + dy;
-    while (cx >= 0 && cx < (int)s.game.width && cy >= 0 && cy < (int)s.game.height) {
-        cell c = s.game.at((size_t)cx, (size_t)cy);
+    while (cx >= 0 && cx < (int)g.width && cy >= 0 && cy < (int)g.height) {
+        cell c = g.at((size_t)cx, (size_t)cy);
         switch (c.type) {
             case cell::white:
                 count++;
@@ -20,69 +25,71 @@ size_t raycast_direction_white(state_t& s, ktl::pos2_size p, size_t dx, size_t d
     return count;
 }
 
-size_t raycast_direction_observers_from_black(state_t& s, ktl::pos2_size start, int dx, int dy) {
-    size_t count = 0;
-
-    int cx = (int)start.x + dx;
-    int cy = (int)start.y + dy;
-
-    while (s.game.in_bounds((size_t)cx, (size_t)cy)) {
-        cell& c = s.game.xy((size_t)cx, (size_t)cy);
+size_t visible_white(scratch_grid& g, ktl::pos2_size p) {
+    if (!g.in_bounds(p)) { return -1; }
 
-        if (c.type == cell::black) { break; }
+    size_t visible = 1;  // self
 
-        if (c.observer_value != -1) { count++; }
-        cx += dx;
-        cy += dy;
-    }
+    visible += raycast_direction_white(g, p, -1, 0);
+    visible += raycast_direction_white(g, p, 1, 0);
+    visible += raycast_direction_white(g, p, 0, -1);
+    visible += raycast_direction_white(g, p, 0, 1);
 
-    return count;
+    return visible;
 }
 
-size_t visible_white(state_t& s, ktl::pos2_size p) {
-    if (!s.game.in_bounds(p)) { return -1; }
+static thread_local ktl::Arena t_generation_arena;
 
-    size_t visible = 1;  // self
+void release_generation_arena() { ktl::arena_free(&t_generation_arena); }
 
-    visible += raycast_direction_white(s, p, -1, 0);
-    visible += raycast_direction_white(s, p, 1, 0);
-    visible += raycast_direction_white(s, p, 0, -1);
-    visible += raycast_direction_white(s, p, 0, 1);
+static std::atomic<uint64_t> g_candidates = 0;
+static std::atomic<uint64_t> g_accepted = 0;
+static std::atomic<uint64_t> g_abandoned = 0;
 
-    return visible;
+generation_stats get_generation_stats() {
+    return {g_candidates.load(std::memory_order_relaxed),
+        g_accepted.load(std::memory_order_relaxed),
+        g_abandoned.load(std::memory_order_relaxed)};
 }
 
-uint32_t generate_board(state_t& s,
-    std::optional<uint32_t> seed,
-    float black_chance,
-    float observer_chance) {
-    zone_scoped_n("board generation");
-
-    // 1. prepare seed and rng
-    std::mt19937 engine;
-    uint32_t u_seed;
-
-    if (seed) {
-        u_seed = *seed;
-    } else {
-        std::random_device rd;
-        u_seed = rd();
-    }
+// steps 2 to 6 for a single candidate board
+static void build_candidate(const generation_params& params, uint32_t u_seed, puzzle_t& out) {
+    // scratch for this board only, the result is copied out into the heap backed puzzle
+    ktl::arena_reset(&t_generation_arena);
 
-    engine.seed(u_seed);
+    out.params = params;
+    out.observers.clear();
+    out.difficulty = -1.0f;
 
-    std::bernoulli_distribution black_rng(black_chance / 100.0f);
+    // every draw is keyed by (seed, phase, cell index), so results do not depend on the standard
+    // library or on the order cells are visited in
+    counter_rng rng(u_seed);
+    uint64_t black_threshold = chance_threshold(params.black_chance);
+    uint64_t observer_threshold = chance_threshold(params.observer_chance);
 
     // 2. reset board
-    s.game.fill(cell{.type = cell::white});
+    scratch_grid g = scratch_grid(params.width,
+        params.height,
+        ktl::ArenaAllocator<cell>(&t_generation_arena),
+        cell{.type = cell::white},
+        ktl::GRID_GROW_OUTWARD | ktl::GRID_NO_RETAIN_STATE);
+
+    // 3. place random black, the whites are mirrored in a bit plane for the connectivity flood
+    static thread_local bit_plane white, reached;
+    white.resize(params.width, params.height);
+    reached.resize(params.width, params.height);
+    for (size_t y = 0; y < params.height; y++) {
+        for (size_t x = 0; x < params.width; x++) {
+            white.set(x, y);
+        }
+    }
 
-    // 3. place random black
-    s.game.traverse(
+    g.traverse(
         {0, 0},
         [&](cell&, ktl::pos2_size p) -> bool {
-            if (black_rng(engine)) {
+            if (rng.chance(RNG_STREAM_BLACK, cell_index(g, p), black_threshold)) {
                 bool black_n = false;
-                s.game.orthogonal_neighbors(p, [&](cell& c, ktl::pos2_size) -> bool {
+                g.orthogonal_neighbors(p, [&](cell& c, ktl::pos2_size) -> bool {
                     if (c.type == cell::black) { black_n = true; }
                     return true;
                 });
@@ -90,71 +97,167 @@ uint32_t generate_board(state_t& s,
             }
             return false;
         },
-        [&](cell& c, ktl::pos2_size) -> bool {
-            cell::type_t old_t = c.type;
-            c.type = cell::black;
-
-            // TODO: optimize this later, already probably enough
-            if (!s.game.is_connected([&](cell& c, ktl::pos2_size) -> bool {
-                    if (c.type == cell::white) { return true; }
-                    return false;
-                })) {
-                c.type = old_t;
+        [&](cell& c, ktl::pos2_size p) -> bool {
+            // the black stays only if the whites stay connected without it
+            white.reset(p.x, p.y);
+
+            size_t x, y;
+            reached.clear();
+            if (plane_first(white, x, y)) reached.set(x, y);
+            flood_plane(reached, white);
+
+            if (reached == white) {
+                c.type = cell::black;
+            } else {
+                white.set(p.x, p.y);
             }
 
             return true;
         });
 
-    std::bernoulli_distribution observer_rng(observer_chance / 100.0f);
+    // 4. place random observers, the draws are independent per cell so they are taken up front in
+    // one flat loop the compiler can vectorize (or that could be split across threads)
+    size_t cell_count = g.width * g.height;
+    std::vector<uint8_t, ktl::ArenaAllocator<uint8_t>> observer_roll(
+        cell_count, 0, ktl::ArenaAllocator<uint8_t>(&t_generation_arena));
+    for (size_t i = 0; i < cell_count; i++) {
+        observer_roll[i] = rng.u32(RNG_STREAM_OBSERVER, i) < observer_threshold;
+    }
 
-    // 4. place random observers
-    s.game.traverse(
-        {0, 0},
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            return c.type == cell::white && observer_rng(engine);
-        },
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            c.observer_value = visible_white(s, p);
-            return true;
-        });
+    for (size_t y = 0; y < g.height; y++) {
+        for (size_t x = 0; x < g.width; x++) {
+            if (!observer_roll[y * g.width + x] || g.at(x, y).type != cell::white) continue;
+            out.observers.push_back({.pos = {x, y}, .value = (int)visible_white(g, {x, y})});
+        }
+    }
 
-    // 5. reject impossible blacks
-    s.game.traverse(
-        {0, 0},
-        [&](cell& c, ktl::pos2_size p) -> bool { return c.type == cell::black; },
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            int visible = 0;
-            visible += raycast_direction_observers_from_black(s, p, -1, 0);
-            visible += raycast_direction_observers_from_black(s, p, 1, 0);
-            visible += raycast_direction_observers_from_black(s, p, 0, -1);
-            visible += raycast_direction_observers_from_black(s, p, 0, 1);
-
-            if (visible == 0) {
-                c.type = cell::white;  // black is unsolvable unset it
+    index_observers(out.observers, g.width, g.height);
+
+    // 5. reject impossible blacks, a black no observer ray ends on can never be deduced. only
+    // unseen blacks get removed so no ray changes and a single pass over the observers is enough
+    std::vector<uint8_t, ktl::ArenaAllocator<uint8_t>> seen(
+        g.width * g.height, 0, ktl::ArenaAllocator<uint8_t>(&t_generation_arena));
+    for (auto& o : out.observers) {
+        for (int d = 0; d < 4; d++) {
+            int cx = (int)o.pos.x + ray_dx[d];
+            int cy = (int)o.pos.y + ray_dy[d];
+
+            while (g.in_bounds((size_t)cx, (size_t)cy)) {
+                if (g.at((size_t)cx, (size_t)cy).type == cell::black) {
+                    seen[cell_index(g, {(size_t)cx, (size_t)cy})] = 1;
+                    break;
+                }
+                cx += ray_dx[d];
+                cy += ray_dy[d];
             }
+        }
+    }
 
-            return true;
-        });
+    for (auto&& [c, pos] : g.items()) {
+        if (c.type == cell::black && !seen[cell_index(g, pos)]) {
+            c.type = cell::white;  // black is unsolvable unset it
+        }
+    }
 
-    s.black_chance = black_chance;
-    s.observer_chance = observer_chance;
+    out.solution.resize(g.width * g.height);
+    for (auto&& [c, pos] : g.items()) {
+        out.solution[cell_index(g, pos)] = c;
+    }
 
-    s.solved_state = s.game;
+    // 6. drop observers the rest already imply, steering does its own trimming
+    if (params.minimize && !params.difficulty.enabled) { minimize_clues(out); }
+}
 
-    // 6. convert solved state into starting position
-    s.game.traverse(
-        {0, 0},
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            if (c.type == cell::black) { return true; }
-            if (c.type == cell::white && c.observer_value == -1) { return true; }
-            return false;
-        },
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            c.type = cell::blank;
-            return true;
-        });
+puzzle_t generate_puzzle(const generation_params& params, std::optional<uint32_t> seed) {
+    zone_scoped_n("board generation");
+
+    // 1. prepare seed
+    uint32_t u_seed;
+
+    if (seed) {
+        u_seed = *seed;
+    } else {
+        std::random_device rd;
+        u_seed = rd();
+    }
+
+    puzzle_t out;
 
-    s.starting_pos = s.game;
+    // 7. steer towards the difficulty band. candidates are derived from the requested seed, so
+    // the seed alone still reproduces the board. when every candidate is abandoned the last one
+    // is handed out as it is
+    size_t candidates = params.difficulty.enabled ? DIFFICULTY_MAX_CANDIDATES : 1;
+    out.band_missed = params.difficulty.enabled;
+    for (size_t attempt = 0; attempt < candidates; attempt++) {
+        uint32_t candidate_seed =
+            attempt == 0 ? u_seed : (uint32_t)splitmix64(((uint64_t)attempt << 32) | u_seed);
 
-    return u_seed;
-}
\ No newline at end of file
+        build_candidate(params, candidate_seed, out);
+        g_candidates.fetch_add(1, std::memory_order_relaxed);
+
+        if (!params.difficulty.enabled ||
+            steer_difficulty(out, params.difficulty, candidate_seed)) {
+            g_accepted.fetch_add(1, std::memory_order_relaxed);
+            out.band_missed = false;
+            break;
+        }
+
+        g_abandoned.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    out.seed = u_seed;
+    return out;
+}
+
+void apply_puzzle(state_t& s, const puzzle_t& p) {
+    zone_scoped_n("apply puzzle");
+
+    s.seed = p.seed;
+    s.black_chance = p.params.black_chance;
+    s.observer_chance = p.params.observer_chance;
+    s.minimize = p.params.minimize;
+    s.difficulty_target = p.params.difficulty;
+    s.difficulty = p.difficulty;
+    s.band_missed = p.band_missed;
+
+    s.solved_state.resize(p.params.width, p.params.height);
+    for (auto&& [c, pos] : s.solved_state.items()) {
+        c = p.solution[cell_index(s.solved_state, pos)];
+    }
+    s.observers = p.observers;
+
+    // convert solved state into starting position
+    s.starting_pos.resize(p.params.width, p.params.height);
+    s.starting_pos.fill(cell{.type = cell::blank});
+    for (auto& o : s.observers) {
+        s.starting_pos.at(o.pos).type = cell::white;
+    }
+
+    s.game = s.starting_pos;
+    s.hash = board_hash(s.game, s.observers);
+    s.mistakes.assign(s.game.width * s.game.height, 0);
+    s.mistakes_version++;
+    s.board_version++;
+
+    s.redo_stack.clear();
+    s.undo_stack.clear();
+    s.solved = false;
+}
+
+uint32_t generate_board(state_t& s,
+    std::optional<uint32_t> seed,
+    float black_chance,
+    float observer_chance,
+    bool minimize) {
+    generation_params params = {
+        .width = s.game.width,
+        .height = s.game.height,
+        .black_chance = black_chance,
+        .observer_chance = observer_chance,
+        .minimize = minimize,
+    };
+
+    apply_puzzle(s, generate_puzzle(params, seed));
+
+    return s.seed;
+}
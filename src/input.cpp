@@ -1,6 +1,9 @@
 #include "input.h"
+#include "endless.h"
 #include "kuromasu.h"
+#include "puzzle_queue.h"
 #include "rendering.h"
+#include "zobrist.h"
 
 static ImVec2 get_mouse_position() {
     float mx, my;
@@ -26,18 +29,28 @@ ktl::pos2_size get_cell_under_mouse(const state_t& s, ImVec2 window_origin) {
         size_t gx = static_cast<size_t>(relative.x / s.cell_size);
         size_t gy = static_cast<size_t>(relative.y / s.cell_size);
 
+        // cells panned out of the game area can't be hit through whatever covers them
+        if (gx < s.camera.x0 || gx >= s.camera.x1 || gy < s.camera.y0 || gy >= s.camera.y1) {
+            return ktl::pos2_size::invalid();
+        }
         return {gx, gy};
     }
 
     return ktl::pos2_size::invalid();
 }
 
+// every edit of the live board goes through here so the state hash stays in step with it
+static void set_game_cell(state_t& s, cell& c, ktl::pos2_size pos, cell::type_t type) {
+    zobrist_update(s.hash, cell_index(s.game, pos), c.type, type);
+    c.type = type;
+}
+
 void undo_action(state_t& s) {
     if (!s.undo_stack.empty()) {
         auto a = s.undo_stack.back();
         for (auto& change : a.changes) {
             auto& c = s.game.at(change.pos);
-            if (c.type == change.new_c) { c.type = change.old_c; }
+            if (c.type == change.new_c) { set_game_cell(s, c, change.pos, change.old_c); }
         }
 
         s.redo_stack.push_back(a);
@@ -50,7 +63,7 @@ void redo_action(state_t& s) {
         auto a = s.redo_stack.back();
         for (auto& change : a.changes) {
             auto& c = s.game.at(change.pos);
-            if (c.type == change.old_c) { c.type = change.new_c; }
+            if (c.type == change.old_c) { set_game_cell(s, c, change.pos, change.new_c); }
         }
 
         s.undo_stack.push_back(a);
@@ -67,6 +80,132 @@ bool is_shift_down() {
     return keys[SDL_SCANCODE_LSHIFT] || keys[SDL_SCANCODE_RSHIFT];
 }
 
+constexpr float CAMERA_MIN_ZOOM = 0.5f;
+constexpr float CAMERA_MIN_CELLS = 4.0f;  // fully zoomed in, this many cells still fit across
+constexpr float CAMERA_WHEEL_STEP = 1.15f;
+
+// scales the zoom by factor while the board point under p (game area coordinates) stays put
+static void camera_zoom_at(state_t& s, ImVec2 p, float factor) {
+    auto& cam = s.camera;
+    if (s.cell_size <= 0.0f) return;
+
+    float max_zoom =
+        std::max(1.0f, (float)std::max(s.game.width, s.game.height) / CAMERA_MIN_CELLS);
+    float zoom = std::clamp(cam.zoom * factor, CAMERA_MIN_ZOOM, max_zoom);
+    float scale = zoom / cam.zoom;
+
+    // the board centre sits at view / 2 + pan and moves away from p by the same scale
+    cam.pan.x = p.x + (cam.view.x / 2 + cam.pan.x - p.x) * scale - cam.view.x / 2;
+    cam.pan.y = p.y + (cam.view.y / 2 + cam.pan.y - p.y) * scale - cam.view.y / 2;
+    cam.zoom = zoom;
+
+    camera_layout(s, cam.origin, cam.view);
+}
+
+static void camera_pan(state_t& s, float dx, float dy) {
+    s.camera.pan.x += dx;
+    s.camera.pan.y += dy;
+    camera_layout(s, s.camera.origin, s.camera.view);
+}
+
+void camera_input(state_t& s) {
+    ImGuiIO& io = ImGui::GetIO();
+
+    if (io.MouseWheel != 0.0f) {
+        ImVec2 p = {io.MousePos.x - s.camera.origin.x, io.MousePos.y - s.camera.origin.y};
+        camera_zoom_at(s, p, powf(CAMERA_WHEEL_STEP, io.MouseWheel));
+    }
+
+    if (ImGui::IsMouseDragging(ImGuiMouseButton_Middle, 0.0f)) {
+        camera_pan(s, io.MouseDelta.x, io.MouseDelta.y);
+    }
+
+    if (ImGui::IsKeyPressed(ImGuiKey_Home)) {
+        s.camera.zoom = 1.0f;
+        s.camera.pan = {0, 0};
+        camera_layout(s, s.camera.origin, s.camera.view);
+    }
+}
+
+// the first finger of a pinch arrives as a left press, whatever it toggled or painted before the
+// second one came down is taken back
+static void cancel_drag(state_t& s) {
+    auto& changes = s.white_fill.drag_action.changes;
+    for (auto it = changes.rbegin(); it != changes.rend(); ++it) {
+        auto& c = s.game.at(it->pos);
+        if (c.type == it->new_c) set_game_cell(s, c, it->pos, it->old_c);
+    }
+    bool changed = !changes.empty();
+    changes.clear();
+
+    s.white_fill.start = ktl::pos2_size::invalid();
+    s.white_fill.cancelled = true;
+    s.erase.start = ktl::pos2_size::invalid();
+    s.erase.rect = {-1, -1, -1, -1};
+    s.erase.dims = {0, 0, 0, 0};
+    if (changed) solve(s);
+}
+
+void camera_event(state_t& s, const SDL_Event* event, SDL_Window* window) {
+    static struct {
+        SDL_FingerID id[2];
+        ImVec2 pos[2];  // window coordinates
+        int count = 0;
+    } touch;
+
+    auto window_pos = [&](float x, float y) -> ImVec2 {
+        int w = 0, h = 0;
+        SDL_GetWindowSize(window, &w, &h);
+        return {x * w, y * h};
+    };
+
+    switch (event->type) {
+        case SDL_EVENT_FINGER_DOWN:
+            if (touch.count < 2) {
+                touch.id[touch.count] = event->tfinger.fingerID;
+                touch.pos[touch.count] = window_pos(event->tfinger.x, event->tfinger.y);
+                touch.count++;
+            }
+            break;
+
+        case SDL_EVENT_FINGER_UP:
+        case SDL_EVENT_FINGER_CANCELED:
+            for (int i = 0; i < touch.count; i++) {
+                if (touch.id[i] != event->tfinger.fingerID) continue;
+                touch.id[i] = touch.id[touch.count - 1];
+                touch.pos[i] = touch.pos[touch.count - 1];
+                touch.count--;
+                break;
+            }
+            break;
+
+        case SDL_EVENT_FINGER_MOTION: {
+            int i = touch.id[0] == event->tfinger.fingerID ? 0 : 1;
+            if (i >= touch.count || touch.id[i] != event->tfinger.fingerID) break;
+
+            ImVec2 a = touch.pos[0], b = touch.pos[1];
+            touch.pos[i] = window_pos(event->tfinger.x, event->tfinger.y);
+            if (touch.count < 2) break;
+
+            ImVec2 na = touch.pos[0], nb = touch.pos[1];
+            float before = hypotf(b.x - a.x, b.y - a.y);
+            float after = hypotf(nb.x - na.x, nb.y - na.y);
+            ImVec2 mid = {
+                (na.x + nb.x) / 2 - s.camera.origin.x,
+                (na.y + nb.y) / 2 - s.camera.origin.y,
+            };
+
+            camera_pan(s, (na.x + nb.x - a.x - b.x) / 2, (na.y + nb.y - a.y - b.y) / 2);
+            if (before > 1.0f && after > 1.0f) camera_zoom_at(s, mid, after / before);
+            break;
+        }
+    }
+
+    bool pinching = touch.count >= 2;
+    if (pinching && !s.camera.pinching) cancel_drag(s);
+    s.camera.pinching = pinching;
+}
+
 void mouse_input(state_t& s, ImVec2 window_origin) {
     //ImGuiIO& io = ImGui::GetIO();
     //if (io.WantCaptureMouse) { return; }
@@ -74,13 +213,14 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
     ktl::pos2_size click = get_cell_under_mouse(s, window_origin);
 
     if (ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+        s.white_fill.cancelled = false;
         if (is_ctrl_down()) {
             s.erase.start = get_cell_under_mouse(s, window_origin);
         } else {
             s.white_fill.start = click;
             if (click != ktl::pos2_size::invalid()) {
                 auto& c = s.game.at(click);
-                if (c.observer_value == -1) {
+                if (!is_observer(s.observers, click)) {
                     cell::type_t next_t;
                     switch (c.type) {
                         case cell::blank:
@@ -95,13 +235,13 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
                     }
 
                     s.white_fill.drag_action.changes.push_back({click, c.type, next_t});
-                    c.type = next_t;
+                    set_game_cell(s, c, click, next_t);
                     if (next_t == cell::black && s.auto_surround) {
                         s.game.orthogonal_neighbors(click, [&](cell& c, ktl::pos2_size p) -> bool {
                             if (c.type == cell::blank) {
                                 s.white_fill.drag_action.changes.push_back(
                                     {p, c.type, cell::white});
-                                c.type = cell::white;
+                                set_game_cell(s, c, p, cell::white);
                             }
                             return true;
                         });
@@ -112,7 +252,7 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
         }
     }
 
-    if (ImGui::IsMouseDown(ImGuiMouseButton_Left)) {
+    if (ImGui::IsMouseDown(ImGuiMouseButton_Left) && !s.white_fill.cancelled) {
         if (is_ctrl_down()) {
             s.erase.dims = grid_rect_from_corners(s.erase.start, click);
             s.erase.rect = grid_region_rect(s, s.erase.dims);
@@ -122,7 +262,7 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
                     auto& c = s.game.at(click);
                     if (c.type == cell::blank) {
                         s.white_fill.drag_action.changes.push_back({click, c.type, cell::white});
-                        c.type = cell::white;
+                        set_game_cell(s, c, click, cell::white);
                         solve(s);
                     }
                 }
@@ -131,11 +271,19 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
     }
 
     if (ImGui::IsMouseReleased(ImGuiMouseButton_Left)) {
-        if (is_ctrl_down()) {
-            for (auto [c, pos] : s.game.items()) {
-                if (is_pos_in_rect(pos, s.erase.dims) && c.observer_value == -1) {
+        if (is_ctrl_down() && !s.white_fill.cancelled && s.erase.dims.w > 0 &&
+            s.erase.dims.h > 0) {
+            size_t x0 = (size_t)s.erase.dims.x, y0 = (size_t)s.erase.dims.y;
+            size_t x1 = x0 + (size_t)s.erase.dims.w, y1 = y0 + (size_t)s.erase.dims.h;
+
+            for (size_t y = y0; y < y1 && y < s.game.height; y++) {
+                for (size_t x = x0; x < x1 && x < s.game.width; x++) {
+                    ktl::pos2_size pos = {x, y};
+                    auto& c = s.game.at(pos);
+                    if (is_observer(s.observers, pos)) continue;
+
                     s.white_fill.drag_action.changes.push_back({pos, c.type, cell::blank});
-                    c.type = cell::blank;
+                    set_game_cell(s, c, pos, cell::blank);
                 }
             }
         }
@@ -146,6 +294,7 @@ void mouse_input(state_t& s, ImVec2 window_origin) {
             s.white_fill.drag_action.changes.clear();
         }
         s.white_fill.start = ktl::pos2_size::invalid();
+        s.white_fill.cancelled = false;
 
         s.erase.start = ktl::pos2_size::invalid();
         s.erase.rect = {-1, -1, -1, -1};
@@ -187,12 +336,24 @@ void keyboard_input(state_t& s) {
 
     if (ImGui::IsKeyPressed(ImGuiKey_N)) {
         if (is_ctrl_down()) {
-            s.seed = generate_board(s);
-            s.redo_stack.clear();
-            s.undo_stack.clear();
-            s.solved = false;
+            endless_destroy(s);
+            next_puzzle(s);
         }
     }
 
+    // arrows pan the endless window a cell at a time, a whole window with shift
+    if (s.endless) {
+        int32_t step_x = is_shift_down() ? (int32_t)s.endless->width : 1;
+        int32_t step_y = is_shift_down() ? (int32_t)s.endless->height : 1;
+        int32_t x = s.endless->x, y = s.endless->y;
+
+        if (ImGui::IsKeyPressed(ImGuiKey_LeftArrow)) x -= step_x;
+        if (ImGui::IsKeyPressed(ImGuiKey_RightArrow)) x += step_x;
+        if (ImGui::IsKeyPressed(ImGuiKey_UpArrow)) y -= step_y;
+        if (ImGui::IsKeyPressed(ImGuiKey_DownArrow)) y += step_y;
+
+        if (x != s.endless->x || y != s.endless->y) endless_move(s, x, y);
+    }
+
     if (ImGui::IsKeyPressed(ImGuiKey_A)) { s.auto_surround = !s.auto_surround; }
 }
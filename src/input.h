@@ -11,6 +11,11 @@ void redo_action(state_t& s);
 bool is_ctrl_down();
 bool is_shift_down();
 
+// wheel zoom around the cursor, middle drag pan and Home to reset
+void camera_input(state_t& s);
+// pinch zoom and two finger pan from touch events
+void camera_event(state_t& s, const SDL_Event* event, SDL_Window* window);
+
 void mouse_input(state_t& s, ImVec2 window_origin);
 void keyboard_input(state_t& s);
 
@@ -0,0 +1,637 @@
+#include "kernels.h"
+#include <utility>
+#include "bitboard.h"
+#include "deduction.h"
+
+// ---------------------------------------------------------------------------------------------
+// fixed size kernels
+
+// cell n steps from i along direction d, the caller keeps it on the board
+template <size_t W, size_t H>
+static constexpr size_t step_cell(int d, size_t i, size_t n) {
+    constexpr ptrdiff_t step[4] = {-1, 1, -(ptrdiff_t)W, (ptrdiff_t)W};
+    return (size_t)((ptrdiff_t)i + step[d] * (ptrdiff_t)n);
+}
+
+// cells from i along direction d before the nearest one in stop, or to the edge without one
+template <size_t W, size_t H>
+static int run_until(int d, size_t i, const bitboard<W, H>& stop) {
+    // left and up walk towards lower indices, so the nearest hit is the highest bit
+    int hit = d == 0 || d == 2 ? stop.highest() : stop.lowest();
+    if (hit < 0) {
+        size_t x = i % W, y = i / W;
+        size_t edge[4] = {x, W - 1 - x, y, H - 1 - y};
+        return (int)edge[d];
+    }
+
+    size_t dist = (size_t)hit > i ? (size_t)hit - i : i - (size_t)hit;
+    return (int)(d < 2 ? dist : dist / W) - 1;
+}
+
+// sums of every pair of lengths out of two sets, bit n set when n can be made
+static uint64_t add_lengths(uint64_t a, uint64_t b) {
+    uint64_t out = 0;
+    while (b) {
+        out |= a << std::countr_zero(b);
+        b &= b - 1;
+    }
+    return out;
+}
+
+template <size_t W, size_t H>
+static bool blacks_touch(const bitboard<W, H>& black) {
+    constexpr const auto& m = bitboard_masks_v<W, H>;
+    return (black & (black.shl(1) & m.not_first_col)).any() || (black & black.shl(W)).any();
+}
+
+template <size_t W, size_t H>
+static bool check_fixed(const observer_table& observers, const std::vector<cell>& cells) {
+    constexpr const auto& m = bitboard_masks_v<W, H>;
+
+    bitboard<W, H> black, white;
+    for (size_t i = 0; i < W * H; i++) {
+        if (cells[i].type == cell::blank) return false;
+        if (cells[i].type == cell::black) {
+            black.set(i);
+        } else {
+            white.set(i);
+        }
+    }
+
+    if (blacks_touch(black)) return false;
+
+    for (auto& o : observers) {
+        size_t i = o.pos.y * W + o.pos.x;
+        if (!white.test(i)) return false;
+
+        int seen = 1;
+        for (int d = 0; d < 4; d++) {
+            seen += run_until<W, H>(d, i, m.ray[d][i] & black);
+        }
+        if (seen != o.value) return false;
+    }
+
+    int first = white.lowest();
+    if (first < 0) return true;
+
+    bitboard<W, H> seed;
+    seed.set((size_t)first);
+    return flood(seed, white) == white;
+}
+
+// with resume the cells already decided in out are taken as the starting point
+template <size_t W, size_t H>
+static kernel_result propagate_fixed(const observer_table& observers,
+    std::vector<cell>& out,
+    bool resume) {
+    constexpr const auto& m = bitboard_masks_v<W, H>;
+
+    bitboard<W, H> black, white;
+    for (size_t i = 0; resume && i < W * H; i++) {
+        if (out[i].type == cell::black) black.set(i);
+        if (out[i].type == cell::white) white.set(i);
+    }
+    for (auto& o : observers) {
+        white.set(o.pos.y * W + o.pos.x);
+    }
+
+    for (;;) {
+        bitboard<W, H> black_before = black;
+        bitboard<W, H> white_before = white;
+
+        white |= and_not(dilate(black), black);
+
+        // blank and not next to a black, taken once per pass. blacks placed later in the pass only
+        // make it a superset, which is still sound and the next pass tightens it
+        bitboard<W, H> can_black = and_not(m.valid, dilate(black) | white);
+
+        for (auto& o : observers) {
+            size_t i = o.pos.y * W + o.pos.x;
+
+            // per direction: whites seen for sure, and cells up to the first black
+            int min_d[4], max_d[4];
+            int total_min = 0, total_max = 0;
+            for (int d = 0; d < 4; d++) {
+                const bitboard<W, H>& ray = m.ray[d][i];
+                min_d[d] = run_until<W, H>(d, i, and_not(ray, white));
+                max_d[d] = run_until<W, H>(d, i, ray & black);
+                total_min += min_d[d];
+                total_max += max_d[d];
+            }
+
+            int want = o.value - 1;
+            if (total_min > want || total_max < want) return kernel_result::CONTRADICTION;
+            if (total_min == total_max) continue;
+
+            // lengths each direction can still end up seeing: to the end of its open run, or up
+            // to a cell that can still turn black. same rule as the deduction engine
+            uint64_t lengths[4];
+            for (int d = 0; d < 4; d++) {
+                uint64_t mask = 0;
+                for (int len = min_d[d]; len <= max_d[d] && len <= want; len++) {
+                    if (len == max_d[d] || can_black.test(step_cell<W, H>(d, i, len + 1))) {
+                        mask |= 1ull << len;
+                    }
+                }
+                lengths[d] = mask;
+            }
+
+            uint64_t before[5], after[5];
+            before[0] = after[4] = 1;
+            for (int d = 0; d < 4; d++) {
+                before[d + 1] = add_lengths(before[d], lengths[d]);
+                after[3 - d] = add_lengths(after[4 - d], lengths[3 - d]);
+            }
+
+            for (int d = 0; d < 4; d++) {
+                uint64_t others = add_lengths(before[d], after[d + 1]);
+
+                uint64_t supported = 0;
+                for (uint64_t rest = lengths[d]; rest; rest &= rest - 1) {
+                    int len = std::countr_zero(rest);
+                    if ((others >> (want - len)) & 1) supported |= 1ull << len;
+                }
+                if (!supported) return kernel_result::CONTRADICTION;
+
+                // the shortest survivor is white for sure, a lone one is closed off
+                int shortest = std::countr_zero(supported);
+                if (shortest > min_d[d]) {
+                    const bitboard<W, H>& past = m.ray[d][step_cell<W, H>(d, i, shortest)];
+                    white |= and_not(m.ray[d][i], past);
+                }
+                if (std::has_single_bit(supported) && shortest < max_d[d]) {
+                    black.set(step_cell<W, H>(d, i, shortest + 1));
+                }
+            }
+        }
+
+        if ((black & white).any() || blacks_touch(black)) return kernel_result::CONTRADICTION;
+        if (black == black_before && white == white_before) break;
+    }
+
+    out.assign(W * H, cell{});
+    for (size_t i = 0; i < W * H; i++) {
+        if (black.test(i)) out[i].type = cell::black;
+        if (white.test(i)) out[i].type = cell::white;
+    }
+
+    if (!((black | white) == m.valid)) return kernel_result::STUCK;
+    return check_fixed<W, H>(observers, out) ? kernel_result::SOLVED
+                                              : kernel_result::CONTRADICTION;
+}
+
+struct size_kernels {
+    bool (*check)(const observer_table&, const std::vector<cell>&);
+    kernel_result (*propagate)(const observer_table&, std::vector<cell>&, bool);
+};
+
+template <size_t... N>
+static constexpr std::array<size_kernels, sizeof...(N)> make_square_kernels(
+    std::index_sequence<N...>) {
+    return {{{check_fixed<KERNEL_MIN_SIZE + N, KERNEL_MIN_SIZE + N>,
+        propagate_fixed<KERNEL_MIN_SIZE + N, KERNEL_MIN_SIZE + N>}...}};
+}
+
+static constexpr auto square_kernels =
+    make_square_kernels(std::make_index_sequence<KERNEL_MAX_SIZE - KERNEL_MIN_SIZE + 1>());
+
+static const size_kernels* find_kernels(size_t width, size_t height) {
+    if (width != height || width < KERNEL_MIN_SIZE || width > KERNEL_MAX_SIZE) return nullptr;
+    return &square_kernels[width - KERNEL_MIN_SIZE];
+}
+
+// ---------------------------------------------------------------------------------------------
+// dynamic fallback
+
+static bool check_dynamic(size_t width,
+    size_t height,
+    const observer_table& observers,
+    const std::vector<cell>& cells) {
+    auto type_at = [&](size_t x, size_t y) { return cells[y * width + x].type; };
+
+    size_t whites = 0;
+    size_t first = SIZE_MAX;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            cell::type_t t = type_at(x, y);
+            if (t == cell::blank) return false;
+            if (t == cell::white) {
+                if (first == SIZE_MAX) first = y * width + x;
+                whites++;
+                continue;
+            }
+
+            if (x + 1 < width && type_at(x + 1, y) == cell::black) return false;
+            if (y + 1 < height && type_at(x, y + 1) == cell::black) return false;
+        }
+    }
+
+    for (auto& o : observers) {
+        if (type_at(o.pos.x, o.pos.y) != cell::white) return false;
+
+        int seen = 1;
+        for (int d = 0; d < 4; d++) {
+            size_t x = o.pos.x + ray_dx[d];
+            size_t y = o.pos.y + ray_dy[d];
+            while (x < width && y < height && type_at(x, y) == cell::white) {
+                seen++;
+                x += ray_dx[d];
+                y += ray_dy[d];
+            }
+        }
+        if (seen != o.value) return false;
+    }
+
+    if (first == SIZE_MAX) return true;
+
+    std::vector<uint8_t> seen(cells.size(), 0);
+    std::vector<size_t> stack = {first};
+    seen[first] = 1;
+    size_t reached = 0;
+    while (!stack.empty()) {
+        size_t i = stack.back();
+        stack.pop_back();
+        reached++;
+
+        for (int d = 0; d < 4; d++) {
+            size_t x = i % width + ray_dx[d];
+            size_t y = i / width + ray_dy[d];
+            if (x >= width || y >= height) continue;
+
+            size_t n = y * width + x;
+            if (seen[n] || cells[n].type != cell::white) continue;
+            seen[n] = 1;
+            stack.push_back(n);
+        }
+    }
+
+    return reached == whites;
+}
+
+// the general engine with its articulation pass off runs the same rules
+static kernel_result propagate_dynamic(size_t width,
+    size_t height,
+    const observer_table& observers,
+    std::vector<cell>& out) {
+    static thread_local deduction_state d;
+
+    deduction_init(d, width, height, observers);
+    d.connectivity = false;
+
+    bool ok = true;
+    for (uint32_t id = 0; id < d.clues.size(); id++) {
+        ok = ok && deduction_activate(d, id);
+    }
+    ok = ok && deduction_propagate(d);
+
+    out.assign(width * height, cell{});
+    for (size_t i = 0; i < out.size(); i++) {
+        out[i].type = d.values[i];
+    }
+
+    if (!ok) return kernel_result::CONTRADICTION;
+
+    for (auto& c : out) {
+        if (c.type == cell::blank) return kernel_result::STUCK;
+    }
+
+    return check_dynamic(width, height, observers, out) ? kernel_result::SOLVED
+                                                        : kernel_result::CONTRADICTION;
+}
+
+// ---------------------------------------------------------------------------------------------
+// bit-sliced batch, bit k of every word belongs to board k
+
+// wide enough for any count on a board up to KERNEL_BATCH_MAX_SIZE, every extra bit is another
+// word in each step of the ray walks
+constexpr int LANE_COUNTER_BITS = 6;
+
+// one small unsigned number per lane, bit b of every lane's number in word b
+using lane_counter = std::array<uint64_t, LANE_COUNTER_BITS>;
+
+// adds one in the lanes of m
+static void lane_increment(lane_counter& c, uint64_t m) {
+    for (int b = 0; b < LANE_COUNTER_BITS; b++) {
+        uint64_t carry = c[b] & m;
+        c[b] ^= m;
+        m = carry;
+    }
+}
+
+static lane_counter lane_subtract(const lane_counter& a, const lane_counter& b) {
+    lane_counter r;
+    uint64_t borrow = 0;
+    for (int i = 0; i < LANE_COUNTER_BITS; i++) {
+        uint64_t diff = a[i] ^ b[i];
+        r[i] = diff ^ borrow;
+        borrow = (~a[i] & b[i]) | (~diff & borrow);
+    }
+    return r;
+}
+
+// lanes where a < b
+static uint64_t lane_less(const lane_counter& a, const lane_counter& b) {
+    uint64_t less = 0, equal = ~0ull;
+    for (int i = LANE_COUNTER_BITS; i-- > 0;) {
+        less |= equal & ~a[i] & b[i];
+        equal &= ~(a[i] ^ b[i]);
+    }
+    return less;
+}
+
+// lanes where a >= k
+static uint64_t lane_at_least(const lane_counter& a, size_t k) {
+    uint64_t greater = 0, equal = ~0ull;
+    for (int i = LANE_COUNTER_BITS; i-- > 0;) {
+        if ((k >> i) & 1) {
+            equal &= a[i];
+        } else {
+            greater |= equal & a[i];
+        }
+    }
+    return greater | equal;
+}
+
+static uint64_t lane_equal(const lane_counter& a, const lane_counter& b) {
+    uint64_t equal = ~0ull;
+    for (int i = 0; i < LANE_COUNTER_BITS; i++) {
+        equal &= ~(a[i] ^ b[i]);
+    }
+    return equal;
+}
+
+struct lane_boards {
+    size_t width = 0;
+    size_t height = 0;
+    uint64_t live = 0;  // lanes holding a board
+
+    // per cell
+    std::vector<uint64_t> black;
+    std::vector<uint64_t> white;
+    std::vector<uint64_t> clue;
+    std::vector<uint64_t> settled;   // clue lanes whose every ray is closed off
+    std::vector<lane_counter> want;  // clue value - 1, cells the observer sees besides itself
+    std::vector<uint64_t> reach;     // scratch for the connectivity flood
+    std::vector<uint64_t> black_before, white_before;
+
+    // lanes where a row / column changed in the last pass. an observer only sees its own row and
+    // column, so it is skipped until one of them changes
+    std::vector<uint64_t> rows_dirty;
+    std::vector<uint64_t> cols_dirty;
+};
+
+static void lanes_reset(lane_boards& b, size_t width, size_t height) {
+    size_t n = width * height;
+    b.width = width;
+    b.height = height;
+    b.live = 0;
+    b.black.assign(n, 0);
+    b.white.assign(n, 0);
+    b.clue.assign(n, 0);
+    b.settled.assign(n, 0);
+    b.want.assign(n, lane_counter{});
+    b.reach.assign(n, 0);
+    b.rows_dirty.assign(height, ~0ull);
+    b.cols_dirty.assign(width, ~0ull);
+}
+
+// false for boards the counters cannot hold, those stay with the scalar kernels
+static bool lanes_load(lane_boards& b, int lane, const observer_table& observers) {
+    for (auto& o : observers) {
+        if (o.value < 1 || o.value > (1 << LANE_COUNTER_BITS)) return false;
+    }
+
+    uint64_t bit = 1ull << lane;
+    for (auto& o : observers) {
+        size_t c = o.pos.y * b.width + o.pos.x;
+        b.clue[c] |= bit;
+        b.white[c] |= bit;
+        for (int i = 0; i < LANE_COUNTER_BITS; i++) {
+            if (((o.value - 1) >> i) & 1) b.want[c][i] |= bit;
+        }
+    }
+    b.live |= bit;
+    return true;
+}
+
+// the neighbour rule and the observer bound rules of propagate_fixed() on every lane at once,
+// returns the lanes that hit a contradiction
+static uint64_t lanes_propagate(lane_boards& b) {
+    size_t w = b.width, h = b.height;
+    uint64_t dead = ~b.live;
+
+    auto step = [&](size_t c, int d, size_t k) {
+        return c + (size_t)(ray_dx[d] * (ptrdiff_t)k) + (size_t)(ray_dy[d] * (ptrdiff_t)k) * w;
+    };
+
+    for (;;) {
+        b.black_before = b.black;
+        b.white_before = b.white;
+
+        for (size_t y = 0; y < h; y++) {
+            for (size_t x = 0; x < w; x++) {
+                size_t c = y * w + x;
+                uint64_t around = 0;
+                if (x > 0) around |= b.black[c - 1];
+                if (x + 1 < w) around |= b.black[c + 1];
+                if (y > 0) around |= b.black[c - w];
+                if (y + 1 < h) around |= b.black[c + w];
+                b.white[c] |= around;
+
+                dead |= b.black[c] & b.white[c];
+                if (x + 1 < w) dead |= b.black[c] & b.black[c + 1];
+                if (y + 1 < h) dead |= b.black[c] & b.black[c + w];
+            }
+        }
+
+        for (size_t c = 0; c < w * h; c++) {
+            size_t x = c % w, y = c / w;
+            uint64_t lanes = b.clue[c] & ~b.settled[c] & ~dead;
+            lanes &= b.rows_dirty[y] | b.cols_dirty[x];
+            if (!lanes) continue;
+
+            size_t edge[4] = {x, w - 1 - x, y, h - 1 - y};
+            const lane_counter& want = b.want[c];
+
+            // whites seen for sure and cells up to the first black, summed while walking out
+            lane_counter total_min{}, total_max{}, max_d[4]{};
+            for (int d = 0; d < 4; d++) {
+                uint64_t whites = lanes, open = lanes;
+                for (size_t k = 1; k <= edge[d] && open; k++) {
+                    size_t n = step(c, d, k);
+                    whites &= b.white[n];
+                    open &= ~b.black[n];
+                    lane_increment(total_min, whites);
+                    lane_increment(max_d[d], open);
+                    lane_increment(total_max, open);
+                }
+            }
+
+            dead |= lanes & (lane_less(want, total_min) | lane_less(total_max, want));
+            b.settled[c] |= lanes & lane_equal(total_min, total_max);
+            lanes &= ~dead & ~b.settled[c];
+
+            // the other directions can't make up the count: with others + k <= want, cell k is
+            // white. slack is want - others, lanes where others already exceed want have none
+            for (int d = 0; d < 4 && lanes; d++) {
+                lane_counter others = lane_subtract(total_max, max_d[d]);
+                lane_counter slack = lane_subtract(want, others);
+                uint64_t needed = lanes & ~lane_less(want, others);
+                for (size_t k = 1; k <= edge[d] && needed; k++) {
+                    needed &= lane_at_least(slack, k);
+                    b.white[step(c, d, k)] |= needed;
+                }
+            }
+
+            // the count is met by whites alone, every run is closed off by a black
+            uint64_t full = lanes & lane_equal(total_min, want);
+            for (int d = 0; d < 4 && full; d++) {
+                uint64_t run = full;
+                for (size_t k = 1; k <= edge[d] && run; k++) {
+                    size_t n = step(c, d, k);
+                    b.black[n] |= run & ~b.white[n];
+                    run &= b.white[n];
+                }
+            }
+        }
+
+        std::fill(b.rows_dirty.begin(), b.rows_dirty.end(), 0);
+        std::fill(b.cols_dirty.begin(), b.cols_dirty.end(), 0);
+
+        uint64_t changed = 0;
+        for (size_t c = 0; c < w * h; c++) {
+            uint64_t m = (b.black[c] ^ b.black_before[c]) | (b.white[c] ^ b.white_before[c]);
+            b.rows_dirty[c / w] |= m;
+            b.cols_dirty[c % w] |= m;
+            changed |= m;
+        }
+
+        if (!(changed & ~dead)) return dead;
+    }
+}
+
+// lanes whose whites form one region, started from each lane's first white cell
+static uint64_t lanes_connected(lane_boards& b, uint64_t lanes) {
+    size_t w = b.width, h = b.height;
+
+    uint64_t seeded = 0;
+    for (size_t c = 0; c < w * h; c++) {
+        b.reach[c] = b.white[c] & ~seeded & lanes;
+        seeded |= b.white[c];
+    }
+
+    // row major sweeps carry the flood right and down in one go, up and left take more of them
+    for (uint64_t changed = ~0ull; changed;) {
+        changed = 0;
+        for (size_t y = 0; y < h; y++) {
+            for (size_t x = 0; x < w; x++) {
+                size_t c = y * w + x;
+                uint64_t around = 0;
+                if (x > 0) around |= b.reach[c - 1];
+                if (x + 1 < w) around |= b.reach[c + 1];
+                if (y > 0) around |= b.reach[c - w];
+                if (y + 1 < h) around |= b.reach[c + w];
+
+                uint64_t m = around & b.white[c] & ~b.reach[c];
+                b.reach[c] |= m;
+                changed |= m;
+            }
+        }
+    }
+
+    for (size_t c = 0; c < w * h; c++) {
+        lanes &= ~(b.white[c] & ~b.reach[c]);
+    }
+    return lanes;
+}
+
+static void propagate_lanes(size_t width,
+    size_t height,
+    const observer_table* const* boards,
+    size_t count,
+    kernel_result* results) {
+    static thread_local lane_boards b;
+    static thread_local std::vector<cell> scratch;
+
+    lanes_reset(b, width, height);
+    for (size_t k = 0; k < count; k++) {
+        lanes_load(b, (int)k, *boards[k]);
+    }
+
+    uint64_t dead = lanes_propagate(b);
+
+    uint64_t decided = b.live & ~dead;
+    for (size_t c = 0; c < width * height; c++) {
+        decided &= b.black[c] | b.white[c];
+    }
+    uint64_t solved = lanes_connected(b, decided);
+
+    // the bound rules ran dry or the board didn't fit, the scalar kernels also have the length
+    // sets. with a kernel for the size they pick up from where the lane stopped
+    const size_kernels* kernels = find_kernels(width, height);
+    for (size_t k = 0; k < count; k++) {
+        uint64_t bit = 1ull << k;
+        if (solved & bit) {
+            results[k] = kernel_result::SOLVED;
+        } else if ((decided | (dead & b.live)) & bit) {
+            results[k] = kernel_result::CONTRADICTION;
+        } else if (kernels && (b.live & bit)) {
+            scratch.assign(width * height, cell{});
+            for (size_t c = 0; c < width * height; c++) {
+                if (b.black[c] & bit) scratch[c].type = cell::black;
+                if (b.white[c] & bit) scratch[c].type = cell::white;
+            }
+            results[k] = kernels->propagate(*boards[k], scratch, true);
+        } else {
+            results[k] = propagate_clues(width, height, *boards[k], scratch);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+
+bool has_size_kernel(size_t width, size_t height) { return find_kernels(width, height) != nullptr; }
+
+bool check_solution(size_t width,
+    size_t height,
+    const observer_table& observers,
+    const std::vector<cell>& cells) {
+    zone_scoped_n("check solution");
+
+    if (cells.size() != width * height) return false;
+
+    if (auto k = find_kernels(width, height)) return k->check(observers, cells);
+    return check_dynamic(width, height, observers, cells);
+}
+
+kernel_result propagate_clues(size_t width,
+    size_t height,
+    const observer_table& observers,
+    std::vector<cell>& out) {
+    zone_scoped_n("propagate clues");
+
+    if (auto k = find_kernels(width, height)) return k->propagate(observers, out, false);
+    return propagate_dynamic(width, height, observers, out);
+}
+
+void propagate_clues_batch(size_t width,
+    size_t height,
+    const std::vector<const observer_table*>& boards,
+    std::vector<kernel_result>& results) {
+    zone_scoped_n("propagate clues batch");
+
+    results.resize(boards.size());
+
+    if (width > KERNEL_BATCH_MAX_SIZE || height > KERNEL_BATCH_MAX_SIZE) {
+        std::vector<cell> scratch;
+        for (size_t i = 0; i < boards.size(); i++) {
+            results[i] = propagate_clues(width, height, *boards[i], scratch);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < boards.size(); i += KERNEL_BATCH_LANES) {
+        size_t count = std::min(KERNEL_BATCH_LANES, boards.size() - i);
+        propagate_lanes(width, height, boards.data() + i, count, results.data() + i);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include "common.h"
+
+// checker and propagation kernels specialised on the board size. square boards from
+// KERNEL_MIN_SIZE to KERNEL_MAX_SIZE each get their own instantiation over compile time sized
+// bitboards, picked at runtime from a table. anything else goes through a dynamic version
+
+constexpr size_t KERNEL_MIN_SIZE = 5;
+constexpr size_t KERNEL_MAX_SIZE = 16;
+
+// boards per propagate_clues_batch() pass, one per bit of a word
+constexpr size_t KERNEL_BATCH_LANES = 64;
+// the bit-sliced counters hold up to 63 cells seen, enough for any board up to this size
+constexpr size_t KERNEL_BATCH_MAX_SIZE = 32;
+
+enum class kernel_result {
+    SOLVED,
+    STUCK,  // the rules ran dry before every cell was decided
+    CONTRADICTION,
+};
+
+bool has_size_kernel(size_t width, size_t height);
+
+// whether a fully decided board keeps every rule: observers see exactly their value, no two
+// blacks touch and the whites are connected
+bool check_solution(size_t width,
+    size_t height,
+    const observer_table& observers,
+    const std::vector<cell>& cells);
+
+// starts from the observers alone and runs the neighbour and observer rules to a fixed point,
+// connectivity is only checked once every cell is decided. out holds whatever got decided
+kernel_result propagate_clues(size_t width,
+    size_t height,
+    const observer_table& observers,
+    std::vector<cell>& out);
+
+// propagate_clues() over many boards of one size. boards are bit-sliced KERNEL_BATCH_LANES at a
+// time, one bit of every cell word per board, and run through the neighbour and bound rules in
+// lockstep. only the boards those leave undecided go through propagate_clues() one at a time
+void propagate_clues_batch(size_t width,
+    size_t height,
+    const std::vector<const observer_table*>& boards,
+    std::vector<kernel_result>& results);
+
+#endif /* KERNELS_H */
@@ -8,6 +8,9 @@
 #include <random>
 #include <utility>
 
+// bump whenever generate_puzzle() can produce a different board for the same seed and settings
+#define KUROMASU_GENERATOR_VERSION 2
+
 struct direction {
     int x, y;
 };
@@ -17,14 +20,39 @@ struct raycast_res {
     bool closed = false;
 };
 
-size_t raycast_direction_white(state_t& s, ktl::pos2_size p, size_t dx, size_t dy);
-raycast_res raycast_direction_non_black(state_t& s, ktl::pos2_size p, size_t dx, size_t dy);
-size_t visible_white(state_t& s, ktl::pos2_size p);
+size_t raycast_direction_white(scratch_grid& g, ktl::pos2_size p, size_t dx, size_t dy);
+raycast_res raycast_direction_non_black(state_t& s,
+    ktl::pos2_size p,
+    size_t dx,
+    size_t dy,
+    size_t max_steps = SIZE_MAX);
+size_t visible_white(scratch_grid& g, ktl::pos2_size p);
+
+// candidates tried for a targeted difficulty before settling for whatever the last one was
+constexpr size_t DIFFICULTY_MAX_CANDIDATES = 64;
+
+struct generation_stats {
+    uint64_t candidates = 0;  // boards built, including ones steering abandoned
+    uint64_t accepted = 0;
+    uint64_t abandoned = 0;
+};
+
+// totals over every thread since startup
+generation_stats get_generation_stats();
+
+puzzle_t generate_puzzle(const generation_params& params,
+    std::optional<uint32_t> seed = std::nullopt);
+void apply_puzzle(state_t& s, const puzzle_t& p);
+
+// every generation works out of a thread local arena that is reset per board, this frees it
+// for the calling thread
+void release_generation_arena();
 
 uint32_t generate_board(state_t& s,
     std::optional<uint32_t> seed = std::nullopt,
     float black_chance = 50.0,
-    float observer_chance = 50.0);
+    float observer_chance = 50.0,
+    bool minimize = false);
 
 void solve(state_t& s);
 
@@ -1,12 +1,21 @@
 #include <imgui_internal.h>
+#include <bit>
 #define NOTIFY_RENDER_OUTSIDE_MAIN_WINDOW false
 #include <ImGuiNotify.hpp>
+#include "alloc_tracking.h"
+#include "animation.h"
+#include "batch.h"
 #include "common.h"
+#include "endless.h"
 #include "external/FA6FreeSolidFontData.h"
 #include "external/IconsFontAwesome6.h"
 #include "input.h"
 #include "kuromasu.h"
+#include "pack.h"
+#include "puzzle_queue.h"
+#include "raster.h"
 #include "rendering.h"
+#include "text_cache.h"
 #include "theme.h"
 #include "ui.h"
 
@@ -18,26 +27,59 @@ extern const char _binary_Roboto_Regular_ttf_end[];
 extern const char _binary_Roboto_Regular_ttf_start[];
 }
 
-ktl::Arena g_arena;
-ktl::ArenaAllocator<cell> g_cell_alloc(&g_arena);
+constexpr uint64_t IDLE_AFTER_NS = 5'000'000'000ull;
+constexpr int IDLE_WAIT_MS = 100;
 
-TTF_Font* get_font(state_t& state, int size, const char* path) {
-    auto it = state.fonts.find(size);
-    if (it != state.fonts.end()) { return it->second; }
+ktl::Arena g_frame_arena;
 
-    TTF_Font* font = TTF_OpenFont(path, (float)size);
+// exact below 16, then steps of 2 up to 32, 4 up to 64 and so on
+static int font_bucket(int size) {
+    size = std::max(size, 1);
+    int step = 1 << std::max(0, (int)std::bit_width((unsigned)size) - 4);
+    return (size + step / 2) / step * step;
+}
+
+TTF_Font* get_font(state_t& state, int size) {
+    size = font_bucket(size);
+    state.font_clock++;
+
+    for (auto& slot : state.fonts) {
+        if (slot.size != size) continue;
+        slot.last_used = state.font_clock;
+        return slot.font;
+    }
+
+    // the blob stays mapped for the whole run, every instance reads it in place
+    size_t blob_size = (size_t)(_binary_Roboto_Regular_ttf_end - _binary_Roboto_Regular_ttf_start);
+    SDL_IOStream* io = SDL_IOFromConstMem(_binary_Roboto_Regular_ttf_start, blob_size);
+    TTF_Font* font = io ? TTF_OpenFontIO(io, true, (float)size) : nullptr;
     if (!font) {
         SDL_Log("Failed to load font: %s", SDL_GetError());
         return nullptr;
     }
 
-    state.fonts[size] = font;
+    if (state.fonts.size() >= FONT_CACHE_CAPACITY) {
+        auto oldest = std::min_element(state.fonts.begin(),
+            state.fonts.end(),
+            [](const font_slot& a, const font_slot& b) { return a.last_used < b.last_used; });
+
+        if (state.text_textures) text_cache_forget_font(state.text_textures, oldest->font);
+        TTF_CloseFont(oldest->font);
+        state.fonts.erase(oldest);
+    }
+
+    state.fonts.push_back({.size = size, .font = font, .last_used = state.font_clock});
     return font;
 }
 
 SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) {
     zone_scoped_n("init");
 
+    if (is_batch_command(argc, argv)) {
+        *appstate = nullptr;
+        return run_batch_command(argc, argv);
+    }
+
     auto* ctx = new ctx_t();
     *appstate = ctx;
 
@@ -133,8 +175,16 @@ SDL_AppResult SDL_AppInit(void** appstate, int argc, char** argv) {
 
     ctx->state.win_image = load_texture(ASSET_DIR "win.jpg", ctx->renderer);
     ctx->state.cursor = load_texture(ASSET_DIR "cursor.png", ctx->renderer);
+    ctx->state.text_textures = text_cache_create();
+    ctx->raster = raster_create(ctx->renderer);
 
     ctx->state.seed = generate_board(ctx->state);
+    ctx->state.queue = puzzle_queue_create({
+        .width = ctx->state.game.width,
+        .height = ctx->state.game.height,
+        .black_chance = ctx->state.black_chance,
+        .observer_chance = ctx->state.observer_chance,
+    });
 
     int w, h;
     SDL_GetWindowSizeInPixels(ctx->window, &w, &h);
@@ -150,8 +200,11 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
     zone_scoped_n("sdl events");
 
     auto* ctx = (ctx_t*)appstate;
+    ctx->last_event_ns = SDL_GetTicksNS();
 
     ImGui_ImplSDL3_ProcessEvent(event);
+    handle_ui_event(ctx, event);
+    camera_event(ctx->state, event, ctx->window);
 
     if (event->type == SDL_EVENT_QUIT) { return SDL_APP_SUCCESS; }
 
@@ -166,9 +219,21 @@ SDL_AppResult SDL_AppEvent(void* appstate, SDL_Event* event) {
 SDL_AppResult SDL_AppIterate(void* appstate) {
     frame_mark();
 
+    alloc_tracking_frame();
+    ktl::arena_reset(&g_frame_arena);
+
     auto* ctx = (ctx_t*)appstate;
     auto& state = ctx->state;
 
+    // nothing is fading in and no event came for long enough that every toast is gone, the last
+    // frame is still what the screen shows, so wait for input instead of drawing it again
+    if (ctx->idle_when_still && !mistake_fades_running(ctx->fades) &&
+        SDL_GetTicksNS() - ctx->last_event_ns > IDLE_AFTER_NS) {
+        SDL_WaitEventTimeout(nullptr, IDLE_WAIT_MS);
+        state.prev_time = SDL_GetTicksNS();
+        return SDL_APP_CONTINUE;
+    }
+
     auto current_time = SDL_GetTicksNS();
     ctx->state.dt = (float)(current_time - state.prev_time) / 1e9;
     ctx->state.prev_time = current_time;
@@ -223,10 +288,13 @@ SDL_AppResult SDL_AppIterate(void* appstate) {
     ImGui::Begin("##game",
         nullptr,
         ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoBackground |
-            ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoNav);
+            ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoNav |
+            ImGuiWindowFlags_NoScrollWithMouse);
 
     ImVec2 cursor_origin = ImGui::GetCursorScreenPos();
-    if (ImGui::IsWindowHovered() || state.white_fill.start != ktl::pos2_size::invalid()) {
+    if (ImGui::IsWindowHovered()) { camera_input(ctx->state); }
+    if ((ImGui::IsWindowHovered() || state.white_fill.start != ktl::pos2_size::invalid()) &&
+        !state.camera.pinching) {
         mouse_input(ctx->state, cursor_origin);
     }
     keyboard_input(ctx->state);
@@ -238,12 +306,7 @@ SDL_AppResult SDL_AppIterate(void* appstate) {
         }
     }
 
-    auto fit_size = std::min(render_size.x, render_size.y);
-    state.cell_size = fit_size / state.game.width;
-    state.offset = {
-        (render_size.x - (state.cell_size * state.game.width)) / 2,
-        (render_size.y - (state.cell_size * state.game.height)) / 2,
-    };
+    camera_layout(state, cursor_origin, render_size);
 
     SDL_SetRenderTarget(ctx->renderer, ctx->game_tex.tex);
     SDL_SetRenderDrawColor(ctx->renderer, 0, 0, 0, 0);
@@ -316,14 +379,27 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result) {
 
     auto* ctx = (ctx_t*)appstate;
 
-    ktl::arena_free(&g_arena);
-
-    for (auto& [_, font_tex] : ctx->state.font_texture_cache) {
-        font_tex.free();
+    if (!ctx) {  // batch commands never create a window
+        SDL_Quit();
+        return;
     }
 
-    for (auto& [size, font] : ctx->state.fonts) {
-        if (font) TTF_CloseFont(font);
+    puzzle_queue_destroy(ctx->state.queue);
+    ctx->state.queue = nullptr;
+
+    delete ctx->state.pack;
+    ctx->state.pack = nullptr;
+
+    endless_destroy(ctx->state);
+
+    release_generation_arena();
+    ktl::arena_free(&g_frame_arena);
+
+    text_cache_destroy(ctx->state.text_textures);
+    ctx->state.text_textures = nullptr;
+
+    for (auto& slot : ctx->state.fonts) {
+        if (slot.font) TTF_CloseFont(slot.font);
     }
 
     ImGui_ImplSDLRenderer3_Shutdown();
@@ -331,6 +407,8 @@ void SDL_AppQuit(void* appstate, SDL_AppResult result) {
     ImGui::DestroyContext();
 
     ctx->game_tex.free();
+    ctx->overview.tex.free();
+    raster_destroy(ctx->raster);
     ctx->state.cursor.free();
     ctx->state.win_image.free();
     SDL_DestroyRenderer(ctx->renderer);
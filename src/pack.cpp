@@ -0,0 +1,253 @@
+#include "pack.h"
+#include <cmath>
+#include "kuromasu.h"
+
+constexpr size_t PACK_HEADER_SIZE = 16;
+constexpr size_t PACK_RECORD_SIZE = 16;
+
+static uint16_t read_le16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t read_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_le16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+static void write_le32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+uint16_t clue_checksum(const observer_table& observers) {
+    // fnv-1a over (x, y, value), folded to 16 bits
+    uint32_t h = 2166136261u;
+    auto mix = [&](uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            h ^= (v >> (i * 8)) & 0xff;
+            h *= 16777619u;
+        }
+    };
+
+    for (auto& o : observers) {
+        mix((uint32_t)o.pos.x);
+        mix((uint32_t)o.pos.y);
+        mix((uint32_t)o.value);
+    }
+
+    return (uint16_t)(h ^ (h >> 16));
+}
+
+static uint16_t quantize_hundredths(float chance) {
+    return (uint16_t)std::lround(std::clamp(chance, 0.0f, 100.0f) * 100.0f);
+}
+
+generation_params pack_quantize_params(const generation_params& params) {
+    generation_params q = params;
+    q.black_chance = quantize_hundredths(params.black_chance) / 100.0f;
+    q.observer_chance = quantize_hundredths(params.observer_chance) / 100.0f;
+    q.difficulty.min = quantize_hundredths(params.difficulty.min) / 100.0f;
+    q.difficulty.max = quantize_hundredths(params.difficulty.max) / 100.0f;
+    return q;
+}
+
+generation_params pack_record_params(const puzzle_pack& pack, const pack_record& r) {
+    return {
+        .width = r.width,
+        .height = r.height,
+        .black_chance = r.black_chance / 100.0f,
+        .observer_chance = r.observer_chance / 100.0f,
+        .minimize = (r.flags & PACK_FLAG_MINIMIZE) != 0,
+        .difficulty =
+            {
+                .enabled = (r.flags & PACK_FLAG_DIFFICULTY) != 0,
+                .min = pack.difficulty_min / 100.0f,
+                .max = pack.difficulty_max / 100.0f,
+            },
+    };
+}
+
+void pack_set_difficulty_band(puzzle_pack& pack, const difficulty_band& band) {
+    pack.difficulty_min = quantize_hundredths(band.min);
+    pack.difficulty_max = quantize_hundredths(band.max);
+}
+
+pack_record pack_record_from_puzzle(const puzzle_t& p) {
+    return {
+        .seed = p.seed,
+        .width = (uint16_t)p.params.width,
+        .height = (uint16_t)p.params.height,
+        .black_chance = quantize_hundredths(p.params.black_chance),
+        .observer_chance = quantize_hundredths(p.params.observer_chance),
+        .checksum = clue_checksum(p.observers),
+        .flags = (uint16_t)((p.params.minimize ? PACK_FLAG_MINIMIZE : 0) |
+                            (p.params.difficulty.enabled ? PACK_FLAG_DIFFICULTY : 0)),
+    };
+}
+
+pack_error pack_load(puzzle_pack& pack, const char* path) {
+    zone_scoped_n("load pack");
+
+    SDL_IOStream* io = SDL_IOFromFile(path, "rb");
+    if (!io) {
+        SDL_Log("Failed to open pack %s: %s", path, SDL_GetError());
+        return pack_error::IO;
+    }
+
+    uint8_t header[PACK_HEADER_SIZE];
+    if (SDL_ReadIO(io, header, sizeof(header)) != sizeof(header)) {
+        SDL_CloseIO(io);
+        return pack_error::TRUNCATED;
+    }
+
+    if (read_le32(header) != KUROMASU_PACK_MAGIC) {
+        SDL_CloseIO(io);
+        return pack_error::BAD_MAGIC;
+    }
+
+    if (read_le16(header + 4) > KUROMASU_PACK_VERSION) {
+        SDL_CloseIO(io);
+        return pack_error::VERSION_NEWER;
+    }
+
+    uint16_t generator = read_le16(header + 6);
+    if (generator != KUROMASU_GENERATOR_VERSION) {
+        SDL_CloseIO(io);
+        return pack_error::GENERATOR_MISMATCH;
+    }
+
+    uint32_t count = read_le32(header + 8);
+
+    // the header is not trusted with the allocation, count has to fit in what the file holds
+    Sint64 size = SDL_GetIOSize(io);
+    if (size < (Sint64)PACK_HEADER_SIZE ||
+        count > ((uint64_t)size - PACK_HEADER_SIZE) / PACK_RECORD_SIZE) {
+        SDL_CloseIO(io);
+        return pack_error::TRUNCATED;
+    }
+
+    pack.difficulty_min = read_le16(header + 12);
+    pack.difficulty_max = read_le16(header + 14);
+
+    std::vector<uint8_t> raw((size_t)count * PACK_RECORD_SIZE);
+    size_t read = raw.empty() ? 0 : SDL_ReadIO(io, raw.data(), raw.size());
+    SDL_CloseIO(io);
+
+    if (read != raw.size()) { return pack_error::TRUNCATED; }
+
+    pack.generator_version = generator;
+    pack.records.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* r = raw.data() + (size_t)i * PACK_RECORD_SIZE;
+        pack.records[i] = {
+            .seed = read_le32(r),
+            .width = read_le16(r + 4),
+            .height = read_le16(r + 6),
+            .black_chance = read_le16(r + 8),
+            .observer_chance = read_le16(r + 10),
+            .checksum = read_le16(r + 12),
+            .flags = read_le16(r + 14),
+        };
+
+        // records go straight to generate_puzzle(), only what the generator is asked for by
+        // the ui gets through
+        const pack_record& rec = pack.records[i];
+        if (rec.width < BOARD_MIN_SIDE || rec.width > BOARD_MAX_SIDE ||
+            rec.height < BOARD_MIN_SIDE || rec.height > BOARD_MAX_SIDE ||
+            rec.black_chance > 10000 || rec.observer_chance > 10000) {
+            pack.records.clear();
+            return pack_error::CORRUPT;
+        }
+    }
+
+    pack.lru.clear();
+    pack.lru_index.clear();
+
+    return pack_error::OK;
+}
+
+pack_error pack_save(const puzzle_pack& pack, const char* path) {
+    zone_scoped_n("save pack");
+
+    std::vector<uint8_t> raw(PACK_HEADER_SIZE + pack.records.size() * PACK_RECORD_SIZE);
+
+    write_le32(raw.data(), KUROMASU_PACK_MAGIC);
+    write_le16(raw.data() + 4, KUROMASU_PACK_VERSION);
+    write_le16(raw.data() + 6, KUROMASU_GENERATOR_VERSION);
+    write_le32(raw.data() + 8, (uint32_t)pack.records.size());
+    write_le16(raw.data() + 12, pack.difficulty_min);
+    write_le16(raw.data() + 14, pack.difficulty_max);
+
+    for (size_t i = 0; i < pack.records.size(); i++) {
+        const pack_record& rec = pack.records[i];
+        uint8_t* r = raw.data() + PACK_HEADER_SIZE + i * PACK_RECORD_SIZE;
+        write_le32(r, rec.seed);
+        write_le16(r + 4, rec.width);
+        write_le16(r + 6, rec.height);
+        write_le16(r + 8, rec.black_chance);
+        write_le16(r + 10, rec.observer_chance);
+        write_le16(r + 12, rec.checksum);
+        write_le16(r + 14, rec.flags);
+    }
+
+    SDL_IOStream* io = SDL_IOFromFile(path, "wb");
+    if (!io) {
+        SDL_Log("Failed to create pack %s: %s", path, SDL_GetError());
+        return pack_error::IO;
+    }
+
+    bool ok = SDL_WriteIO(io, raw.data(), raw.size()) == raw.size();
+    if (!SDL_CloseIO(io)) ok = false;
+
+    return ok ? pack_error::OK : pack_error::IO;
+}
+
+const puzzle_t* pack_get(puzzle_pack& pack, size_t index, pack_error* err) {
+    zone_scoped_n("pack get");
+
+    if (err) *err = pack_error::OK;
+
+    if (index >= pack.records.size()) {
+        if (err) *err = pack_error::OUT_OF_RANGE;
+        return nullptr;
+    }
+
+    auto it = pack.lru_index.find(index);
+    if (it != pack.lru_index.end()) {
+        pack.lru.splice(pack.lru.begin(), pack.lru, it->second);
+        return &pack.lru.front().second;
+    }
+
+    const pack_record& rec = pack.records[index];
+    puzzle_t p = generate_puzzle(pack_record_params(pack, rec), rec.seed);
+
+    if (clue_checksum(p.observers) != rec.checksum) {
+        if (err) *err = pack_error::CHECKSUM_MISMATCH;
+        return nullptr;
+    }
+
+    if (pack.lru.size() >= pack.lru_capacity && !pack.lru.empty()) {
+        pack.lru_index.erase(pack.lru.back().first);
+        pack.lru.pop_back();
+    }
+
+    pack.lru.emplace_front(index, std::move(p));
+    pack.lru_index[index] = pack.lru.begin();
+
+    return &pack.lru.front().second;
+}
+
+pack_error open_pack_puzzle(state_t& s, size_t index) {
+    if (!s.pack) return pack_error::OUT_OF_RANGE;
+
+    pack_error err;
+    const puzzle_t* p = pack_get(*s.pack, index, &err);
+    if (!p) return err;
+
+    apply_puzzle(s, *p);
+    s.pack_index = index;
+
+    return pack_error::OK;
+}
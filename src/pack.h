@@ -0,0 +1,108 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+
+// puzzle packs store only what generate_puzzle() needs to rebuild a board, plus a short checksum
+// of the clues it is expected to produce. boards are regenerated on open, the last few opened
+// ones are kept materialized
+//
+// layout, little endian:
+//   header  "KPAK" | u16 pack version | u16 generator version | u32 count |
+//           u16 difficulty min | u16 difficulty max
+//   record  u32 seed | u16 width | u16 height | u16 black | u16 observer | u16 checksum | u16 flags
+// chances and the difficulty band are stored in hundredths, flags hold the boolean generation
+// settings. the band is shared by every record that has PACK_FLAG_DIFFICULTY set
+
+#define KUROMASU_PACK_VERSION 1
+#define KUROMASU_PACK_MAGIC 0x4b41504bu  // "KPAK"
+
+constexpr size_t PACK_LRU_CAPACITY = 16;
+
+constexpr uint16_t PACK_FLAG_MINIMIZE = 1 << 0;
+constexpr uint16_t PACK_FLAG_DIFFICULTY = 1 << 1;
+
+enum class pack_error {
+    OK,
+    IO,
+    BAD_MAGIC,
+    VERSION_NEWER,
+    GENERATOR_MISMATCH,
+    TRUNCATED,
+    OUT_OF_RANGE,
+    CHECKSUM_MISMATCH,
+    CORRUPT
+};
+
+inline const char* get_pack_error_message(pack_error err) noexcept {
+    switch (err) {
+        case pack_error::OK:
+            return "ok";
+        case pack_error::IO:
+            return "Could not read or write the pack file";
+        case pack_error::BAD_MAGIC:
+            return "Not a puzzle pack";
+        case pack_error::VERSION_NEWER:
+            return "Pack version is newer than supported";
+        case pack_error::GENERATOR_MISMATCH:
+            return "Pack was built by a different board generator";
+        case pack_error::TRUNCATED:
+            return "Pack file is truncated";
+        case pack_error::OUT_OF_RANGE:
+            return "Puzzle index is out of range";
+        case pack_error::CHECKSUM_MISMATCH:
+            return "Regenerated board does not match the pack";
+        case pack_error::CORRUPT:
+            return "Pack holds a record that is not a valid board";
+
+        default:
+            return "n/a";
+    }
+}
+
+struct pack_record {
+    uint32_t seed = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint16_t black_chance = 0;
+    uint16_t observer_chance = 0;
+    uint16_t checksum = 0;
+    uint16_t flags = 0;
+};
+
+struct puzzle_pack {
+    uint16_t generator_version = 0;
+    uint16_t difficulty_min = 0;
+    uint16_t difficulty_max = 0;
+    std::vector<pack_record> records;
+
+    // most recently opened first
+    std::list<std::pair<size_t, puzzle_t>> lru;
+    std::unordered_map<size_t, std::list<std::pair<size_t, puzzle_t>>::iterator> lru_index;
+    size_t lru_capacity = PACK_LRU_CAPACITY;
+};
+
+uint16_t clue_checksum(const observer_table& observers);
+
+// rounds the chances to what a record can hold, generate with these so the pack reproduces
+generation_params pack_quantize_params(const generation_params& params);
+generation_params pack_record_params(const puzzle_pack& pack, const pack_record& r);
+pack_record pack_record_from_puzzle(const puzzle_t& p);
+
+// the band stored in the header, every targeted record in a pack has to use the same one
+void pack_set_difficulty_band(puzzle_pack& pack, const difficulty_band& band);
+
+pack_error pack_load(puzzle_pack& pack, const char* path);
+pack_error pack_save(const puzzle_pack& pack, const char* path);
+
+// regenerates (or fetches from the lru) the board at index, nullptr on error
+const puzzle_t* pack_get(puzzle_pack& pack, size_t index, pack_error* err = nullptr);
+
+// loads the board at index from the state's pack into the state
+pack_error open_pack_puzzle(state_t& s, size_t index);
+
+#endif /* PACK_H */
@@ -0,0 +1,142 @@
+#include "puzzle_queue.h"
+#include "kuromasu.h"
+
+static int puzzle_queue_worker(void* data) {
+    auto* q = (puzzle_queue*)data;
+
+    SDL_SetCurrentThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    SDL_LockMutex(q->lock);
+    while (!q->quit) {
+        if (q->ready.size() >= q->depth) {
+            SDL_WaitCondition(q->wake, q->lock);
+            continue;
+        }
+
+        generation_params params = q->params;
+        uint64_t epoch = q->epoch;
+        SDL_UnlockMutex(q->lock);
+
+        puzzle_t p = generate_puzzle(params);
+
+        SDL_LockMutex(q->lock);
+        if (q->epoch == epoch && q->ready.size() < q->depth) { q->ready.push_back(std::move(p)); }
+    }
+    SDL_UnlockMutex(q->lock);
+
+    release_generation_arena();
+
+    return 0;
+}
+
+puzzle_queue* puzzle_queue_create(const generation_params& params, size_t depth) {
+    auto* q = new puzzle_queue();
+    q->params = params;
+    q->depth = depth;
+
+    q->lock = SDL_CreateMutex();
+    q->wake = SDL_CreateCondition();
+    if (!q->lock || !q->wake) {
+        SDL_Log("Failed to create puzzle queue sync primitives: %s", SDL_GetError());
+        puzzle_queue_destroy(q);
+        return nullptr;
+    }
+
+    q->worker = SDL_CreateThread(puzzle_queue_worker, "puzzle prefetch", q);
+    if (!q->worker) {
+        SDL_Log("Failed to start puzzle prefetch thread: %s", SDL_GetError());
+        puzzle_queue_destroy(q);
+        return nullptr;
+    }
+
+    return q;
+}
+
+void puzzle_queue_destroy(puzzle_queue* q) {
+    if (!q) return;
+
+    if (q->worker) {
+        SDL_LockMutex(q->lock);
+        q->quit = true;
+        SDL_SignalCondition(q->wake);
+        SDL_UnlockMutex(q->lock);
+
+        SDL_WaitThread(q->worker, nullptr);
+    }
+
+    if (q->wake) SDL_DestroyCondition(q->wake);
+    if (q->lock) SDL_DestroyMutex(q->lock);
+
+    delete q;
+}
+
+void puzzle_queue_configure(puzzle_queue* q, const generation_params& params) {
+    if (!q) return;
+
+    SDL_LockMutex(q->lock);
+    if (!(q->params == params)) {
+        q->params = params;
+        q->epoch++;
+        q->ready.clear();
+        SDL_SignalCondition(q->wake);
+    }
+    SDL_UnlockMutex(q->lock);
+}
+
+bool puzzle_queue_pop(puzzle_queue* q, puzzle_t& out) {
+    if (!q) return false;
+
+    bool popped = false;
+
+    SDL_LockMutex(q->lock);
+    if (!q->ready.empty()) {
+        out = std::move(q->ready.front());
+        q->ready.pop_front();
+        popped = true;
+        SDL_SignalCondition(q->wake);
+    }
+    SDL_UnlockMutex(q->lock);
+
+    return popped;
+}
+
+size_t puzzle_queue_ready(puzzle_queue* q) {
+    if (!q) return 0;
+
+    SDL_LockMutex(q->lock);
+    size_t n = q->ready.size();
+    SDL_UnlockMutex(q->lock);
+
+    return n;
+}
+
+void next_puzzle(state_t& s) {
+    zone_scoped_n("next puzzle");
+
+    puzzle_t p;
+    if (puzzle_queue_pop(s.queue, p)) {
+        apply_puzzle(s, p);
+        return;
+    }
+
+    {
+        zone_scoped_nc("prefetch miss", PROF_COLOR_RED);
+
+        generation_params params = {
+            .width = s.game.width,
+            .height = s.game.height,
+            .black_chance = s.black_chance,
+            .observer_chance = s.observer_chance,
+            .minimize = s.minimize,
+            .difficulty = s.difficulty_target,
+        };
+
+        if (s.queue) {
+            SDL_LockMutex(s.queue->lock);
+            params = s.queue->params;
+            SDL_UnlockMutex(s.queue->lock);
+        }
+
+        apply_puzzle(s, generate_puzzle(params));
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef PUZZLE_QUEUE_H
+#define PUZZLE_QUEUE_H
+
+#include <deque>
+#include "common.h"
+
+constexpr size_t PUZZLE_QUEUE_DEPTH = 3;
+
+// keeps the next few boards for the current generation settings ready, so "new puzzle" never
+// waits on the generator. a single low priority worker refills the queue whenever it drops
+// below its depth, changing the settings throws away everything generated for the old ones
+struct puzzle_queue {
+    SDL_Thread* worker = nullptr;
+    SDL_Mutex* lock = nullptr;
+    SDL_Condition* wake = nullptr;
+
+    generation_params params;
+    uint64_t epoch = 0;  // bumped on every settings change, stale results get dropped
+    size_t depth = PUZZLE_QUEUE_DEPTH;
+    bool quit = false;
+
+    std::deque<puzzle_t> ready;
+};
+
+puzzle_queue* puzzle_queue_create(const generation_params& params,
+    size_t depth = PUZZLE_QUEUE_DEPTH);
+void puzzle_queue_destroy(puzzle_queue* q);
+
+void puzzle_queue_configure(puzzle_queue* q, const generation_params& params);
+bool puzzle_queue_pop(puzzle_queue* q, puzzle_t& out);
+size_t puzzle_queue_ready(puzzle_queue* q);
+
+// applies a prefetched board if one is ready, otherwise generates one in place
+void next_puzzle(state_t& s);
+
+#endif /* PUZZLE_QUEUE_H */
@@ -0,0 +1,284 @@
+#include "raster.h"
+#include "rendering.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// ARGB8888, the same colours draw_grid() uses
+constexpr uint32_t RASTER_BORDER = 0xff000000u;
+constexpr uint32_t RASTER_MISTAKE = 0xff0000u;
+constexpr uint32_t RASTER_TEXT = 0x000000u;
+constexpr uint32_t RASTER_TEXT_SATISFIED = 0x828282u;
+
+static uint32_t raster_texel(cell::type_t type) {
+    switch (type) {
+        case cell::black:
+            return 0xff000000u;
+        case cell::white:
+            return 0xffffffffu;
+        case cell::blank:
+            break;
+    }
+    return 0xff505050u;
+}
+
+void fill_span(uint32_t* dst, size_t count, uint32_t value) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i v8 = _mm256_set1_epi32((int)value);
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i), v8);
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i v4 = _mm_set1_epi32((int)value);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i), v4);
+    }
+#elif defined(__ARM_NEON)
+    uint32x4_t v4 = vdupq_n_u32(value);
+    for (; i + 4 <= count; i += 4) {
+        vst1q_u32(dst + i, v4);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = value;
+    }
+}
+
+// rgb over an opaque pixel with coverage a out of 255, both channel pairs in one multiply. a is
+// stretched to 0-256 so full coverage lands exactly on rgb after the shift
+static inline uint32_t blend_opaque(uint32_t dst, uint32_t rgb, uint32_t a) {
+    a += a >> 7;
+    uint32_t inv = 256 - a;
+    uint32_t rb = (((rgb & 0xff00ffu) * a + (dst & 0xff00ffu) * inv) >> 8) & 0xff00ffu;
+    uint32_t g = (((rgb & 0x00ff00u) * a + (dst & 0x00ff00u) * inv) >> 8) & 0x00ff00u;
+    return 0xff000000u | rb | g;
+}
+
+static void build_digit_strip(board_raster& r, TTF_Font* font, int size) {
+    zone_scoped_n("build digit strip");
+
+    SDL_Surface* glyphs[10] = {};
+    r.strip_w = 0;
+    r.strip_h = 0;
+
+    for (int d = 0; d < 10; d++) {
+        char text[2] = {(char)('0' + d), 0};
+        SDL_Surface* rendered = TTF_RenderText_Blended(font, text, 0, {255, 255, 255, 255});
+        if (!rendered) continue;
+
+        glyphs[d] = SDL_ConvertSurface(rendered, SDL_PIXELFORMAT_ARGB8888);
+        SDL_DestroySurface(rendered);
+        if (!glyphs[d]) continue;
+
+        r.digit_x[d] = r.strip_w;
+        r.digit_w[d] = glyphs[d]->w;
+        r.strip_w += glyphs[d]->w;
+        r.strip_h = std::max(r.strip_h, glyphs[d]->h);
+    }
+
+    // only the alpha of the white glyphs is kept, it is the coverage the text colour blends with
+    r.strip.assign((size_t)r.strip_w * r.strip_h, 0);
+    for (int d = 0; d < 10; d++) {
+        SDL_Surface* g = glyphs[d];
+        if (!g) {
+            r.digit_w[d] = 0;
+            continue;
+        }
+
+        for (int y = 0; y < g->h; y++) {
+            const uint32_t* src = (const uint32_t*)((const uint8_t*)g->pixels + y * g->pitch);
+            uint8_t* dst = &r.strip[(size_t)y * r.strip_w + r.digit_x[d]];
+            for (int x = 0; x < g->w; x++) {
+                dst[x] = (uint8_t)(src[x] >> 24);
+            }
+        }
+        SDL_DestroySurface(g);
+    }
+
+    r.digit_size = size;
+}
+
+static void build_disc(board_raster& r, int radius) {
+    r.disc_radius = radius;
+    r.disc_half.resize((size_t)radius * 2 + 1);
+    for (int dy = -radius; dy <= radius; dy++) {
+        r.disc_half[dy + radius] = (int)SDL_floorf(SDL_sqrtf((float)(radius * radius - dy * dy)));
+    }
+}
+
+board_raster* raster_create(SDL_Renderer* renderer) {
+    auto* r = new board_raster();
+    const char* name = SDL_GetRendererName(renderer);
+    r->enabled = name && SDL_strcmp(name, SDL_SOFTWARE_RENDERER) == 0;
+    return r;
+}
+
+void raster_destroy(board_raster* r) {
+    if (!r) return;
+    r->tex.free();
+    delete r;
+}
+
+bool raster_board(ctx_t* ctx) {
+    zone_scoped_n("raster board");
+
+    auto& s = ctx->state;
+    auto& r = *ctx->raster;
+    int w = (int)ctx->game_tex.w;
+    int h = (int)ctx->game_tex.h;
+    if (w <= 0 || h <= 0) return false;
+
+    if (!r.tex.tex || r.tex.w != w || r.tex.h != h) {
+        r.tex.free();
+        r.tex.tex = SDL_CreateTexture(
+            ctx->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+        if (!r.tex.tex) {
+            SDL_Log("Failed to create raster texture: %s", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureBlendMode(r.tex.tex, SDL_BLENDMODE_BLEND);
+        r.tex.w = (float)w;
+        r.tex.h = (float)h;
+    }
+
+    void* pixels;
+    int pitch;
+    if (!SDL_LockTexture(r.tex.tex, nullptr, &pixels, &pitch)) {
+        SDL_Log("Failed to lock raster texture: %s", SDL_GetError());
+        return false;
+    }
+    uint32_t* px = (uint32_t*)pixels;
+    size_t stride = (size_t)pitch / 4;
+
+    // a locked texture holds garbage, everything off the board is cleared to transparent
+    for (int y = 0; y < h; y++) {
+        fill_span(px + y * stride, (size_t)w, 0);
+    }
+
+    size_t cols = s.camera.x1 - s.camera.x0;
+
+    // pixel edges of the visible columns, edge i + 1 is where column i ends
+    int* xs = make_frame_array<int>(cols + 1);
+    for (size_t i = 0; i <= cols; i++) {
+        xs[i] = (int)SDL_floorf(s.offset.x + (s.camera.x0 + i) * s.cell_size);
+    }
+    uint32_t* colors = make_frame_array<uint32_t>(cols);
+
+    {
+        zone_scoped_n("cells");
+
+        for (size_t cy = s.camera.y0; cy < s.camera.y1; cy++) {
+            int top = (int)SDL_floorf(s.offset.y + cy * s.cell_size);
+            int bottom = (int)SDL_floorf(s.offset.y + (cy + 1) * s.cell_size);
+
+            for (size_t i = 0; i < cols; i++) {
+                colors[i] = raster_texel(s.game.at(s.camera.x0 + i, cy).type);
+            }
+
+            for (int py = std::max(top, 0); py < std::min(bottom, h); py++) {
+                uint32_t* row = px + py * stride;
+                bool edge_row = py == top || py == bottom - 1;
+
+                for (size_t i = 0; i < cols; i++) {
+                    int left = xs[i], right = xs[i + 1];
+                    if (right <= left) continue;
+
+                    if (edge_row) {
+                        int a = std::max(left, 0), b = std::min(right, w);
+                        if (b > a) fill_span(row + a, (size_t)(b - a), RASTER_BORDER);
+                        continue;
+                    }
+
+                    int a = std::max(left + 1, 0), b = std::min(right - 1, w);
+                    if (b > a) fill_span(row + a, (size_t)(b - a), colors[i]);
+                    if (left >= 0 && left < w) row[left] = RASTER_BORDER;
+                    if (right - 1 >= 0 && right - 1 < w) row[right - 1] = RASTER_BORDER;
+                }
+            }
+        }
+    }
+
+    if (!ctx->fades.active.empty()) {
+        zone_scoped_n("mistake discs");
+
+        int radius = (int)((s.cell_size / 2) - (s.cell_size / 10));
+        if (radius != r.disc_radius) build_disc(r, radius);
+
+        for (const auto& f : ctx->fades.active) {
+            ktl::pos2_size pos = {f.index % s.game.width, f.index / s.game.width};
+            if (f.alpha <= 0.0f || !is_visible(s, pos)) continue;
+
+            size_t i = pos.x - s.camera.x0;
+            int cx = (xs[i] + xs[i + 1]) / 2;
+            int cy = ((int)SDL_floorf(s.offset.y + pos.y * s.cell_size) +
+                         (int)SDL_floorf(s.offset.y + (pos.y + 1) * s.cell_size)) /
+                     2;
+            uint32_t alpha = (uint32_t)fade(255, f.alpha);
+
+            for (int dy = -radius; dy <= radius; dy++) {
+                int py = cy + dy;
+                if (py < 0 || py >= h) continue;
+
+                int half = r.disc_half[dy + radius];
+                uint32_t* row = px + py * stride;
+                for (int x = std::max(cx - half, 0); x < std::min(cx + half + 1, w); x++) {
+                    row[x] = blend_opaque(row[x], RASTER_MISTAKE, alpha);
+                }
+            }
+        }
+    }
+
+    TTF_Font* font = get_font(s, static_cast<int>(s.cell_size * 0.6f));
+    if (font) {
+        zone_scoped_n("observer digits");
+
+        int size = (int)TTF_GetFontSize(font);
+        if (size != r.digit_size) build_digit_strip(r, font, size);
+
+        auto first_visible = std::lower_bound(s.observers.begin(),
+            s.observers.end(),
+            ktl::pos2_size{0, s.camera.y0},
+            observer_before);
+
+        for (auto it = first_visible; it != s.observers.end() && it->pos.y < s.camera.y1; ++it) {
+            const observer& o = *it;
+            if (o.pos.x < s.camera.x0 || o.pos.x >= s.camera.x1) continue;
+            if (s.game.at(o.pos).type != cell::white) continue;
+
+            char digits[16];
+            int len = SDL_snprintf(digits, sizeof(digits), "%d", o.value);
+            int text_w = 0;
+            for (int k = 0; k < len; k++) {
+                if (digits[k] >= '0' && digits[k] <= '9') text_w += r.digit_w[digits[k] - '0'];
+            }
+
+            ImVec2 center = grid_cell_center(s, o.pos);
+            int x = (int)(center.x - text_w * 0.5f);
+            int y = (int)(center.y - r.strip_h * 0.5f);
+            uint32_t rgb = o.satisfied ? RASTER_TEXT_SATISFIED : RASTER_TEXT;
+
+            for (int k = 0; k < len; k++) {
+                if (digits[k] < '0' || digits[k] > '9') continue;
+                int d = digits[k] - '0';
+
+                for (int gy = std::max(0, -y); gy < r.strip_h && y + gy < h; gy++) {
+                    uint32_t* row = px + (y + gy) * stride;
+                    const uint8_t* cov = &r.strip[(size_t)gy * r.strip_w + r.digit_x[d]];
+                    for (int gx = std::max(0, -x); gx < r.digit_w[d] && x + gx < w; gx++) {
+                        if (cov[gx]) row[x + gx] = blend_opaque(row[x + gx], rgb, cov[gx]);
+                    }
+                }
+                x += r.digit_w[d];
+            }
+        }
+    }
+
+    SDL_UnlockTexture(r.tex.tex);
+    SDL_RenderTexture(ctx->renderer, r.tex.tex, nullptr, nullptr);
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "common.h"
+
+// draws the board on the cpu for SDL's software renderer, where every cell would otherwise be a
+// fill and an outline call through the renderer. cell fills, borders, mistake discs and observer
+// digits are written straight into a streaming texture the size of the game area with vector span
+// fills, which then goes out as a single quad. the measure and erase overlays still draw on top of
+// it through the renderer
+struct board_raster {
+    bool enabled = false;
+    Texture tex;
+
+    // digits 0-9 side by side as 8 bit coverage, rendered once per font size
+    int digit_size = 0;
+    std::vector<uint8_t> strip;
+    int strip_w = 0;
+    int strip_h = 0;
+    int digit_x[10] = {};
+    int digit_w[10] = {};
+
+    // half width of every row of a mistake disc at the current radius
+    int disc_radius = -1;
+    std::vector<int> disc_half;
+};
+
+// on by default when the renderer is SDL's software one
+board_raster* raster_create(SDL_Renderer* renderer);
+void raster_destroy(board_raster* r);
+
+// draws the visible part of the board into the current render target, false when the texture
+// can't be had and the caller should draw through the renderer instead
+bool raster_board(ctx_t* ctx);
+
+// dst[0, count) = value, as wide stores where the target has them
+void fill_span(uint32_t* dst, size_t count, uint32_t value);
+
+#endif /* RASTER_H */
@@ -1,9 +1,16 @@
 #include "rendering.h"
 #include <SDL3/SDL_render.h>
+#include <array>
+#include "alloc_tracking.h"
+#include "animation.h"
 #include "common.h"
+#include "endless.h"
 #include "external/memory_usage.h"
 #include "input.h"
+#include "kuromasu.h"
 #include "math.h"
+#include "raster.h"
+#include "text_cache.h"
 
 ImVec2 grid_to_screen_pos(const state_t& s, int grid_x, int grid_y) {
     zone_scoped_n("grid to screen pos");
@@ -95,33 +102,62 @@ void set_render_color(SDL_Renderer* renderer, SDL_Color color) {
     SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
 }
 
-void draw_filled_circle(SDL_Renderer* renderer,
-    float centerX,
-    float centerY,
-    float radius,
-    SDL_Color color) {
-    zone_scoped_n("draw filled circle");
+constexpr int DISC_SEGMENTS = 64;
 
-    const int segments = 64;
-    SDL_Vertex vertices[segments + 2];
-    int indices[segments * 3];
+// points around the unit circle, computed once and scaled into every disc
+static const std::array<SDL_FPoint, DISC_SEGMENTS>& unit_circle() {
+    static const std::array<SDL_FPoint, DISC_SEGMENTS> table = [] {
+        std::array<SDL_FPoint, DISC_SEGMENTS> t;
+        for (int i = 0; i < DISC_SEGMENTS; i++) {
+            float angle = i * 2.0f * SDL_PI_F / DISC_SEGMENTS;
+            t[i] = {SDL_cosf(angle), SDL_sinf(angle)};
+        }
+        return t;
+    }();
+    return table;
+}
 
+void disc_batch_add(disc_batch& b, float center_x, float center_y, float radius, SDL_Color color) {
+    int base = (int)b.vertices.size();
     SDL_FColor fc = {color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f};
-    vertices[0] = {{centerX, centerY}, fc, {0, 0}};
 
-    for (int i = 0; i <= segments; i++) {
-        float angle = i * 2.0f * SDL_PI_F / segments;
-        vertices[i + 1] = {
-            {centerX + radius * SDL_cosf(angle), centerY + radius * SDL_sinf(angle)}, fc, {0, 0}};
+    b.vertices.push_back({{center_x, center_y}, fc, {0, 0}});
+    for (const auto& p : unit_circle()) {
+        b.vertices.push_back({{center_x + radius * p.x, center_y + radius * p.y}, fc, {0, 0}});
     }
 
-    for (int i = 0; i < segments; i++) {
-        indices[i * 3 + 0] = 0;
-        indices[i * 3 + 1] = i + 1;
-        indices[i * 3 + 2] = i + 2;
+    // a fan around the centre, the last triangle closes back onto the first rim point
+    for (int i = 0; i < DISC_SEGMENTS; i++) {
+        b.indices.push_back(base);
+        b.indices.push_back(base + 1 + i);
+        b.indices.push_back(base + 1 + (i + 1) % DISC_SEGMENTS);
     }
+}
+
+void disc_batch_flush(SDL_Renderer* renderer, disc_batch& b) {
+    zone_scoped_n("flush discs");
+    if (b.indices.empty()) return;
+
+    SDL_RenderGeometry(renderer,
+        NULL,
+        b.vertices.data(),
+        (int)b.vertices.size(),
+        b.indices.data(),
+        (int)b.indices.size());
+    b.vertices.clear();
+    b.indices.clear();
+}
+
+void draw_filled_circle(SDL_Renderer* renderer,
+    float centerX,
+    float centerY,
+    float radius,
+    SDL_Color color) {
+    zone_scoped_n("draw filled circle");
 
-    SDL_RenderGeometry(renderer, NULL, vertices, segments + 2, indices, segments * 3);
+    static thread_local disc_batch batch;
+    disc_batch_add(batch, centerX, centerY, radius, color);
+    disc_batch_flush(renderer, batch);
 }
 
 void draw_text(ctx_t* ctx, TTF_Font* font, const char* text, float x, float y, SDL_Color color) {
@@ -129,130 +165,264 @@ void draw_text(ctx_t* ctx, TTF_Font* font, const char* text, float x, float y, S
 
     if (!text || !font || !ctx->renderer) return;
 
-    uint64_t key = get_font_cache_key(font, text, color);
-    auto it = ctx->state.font_texture_cache.find(key);
-    if (it == ctx->state.font_texture_cache.end()) {
-        zone_scoped_nc("cache miss", PROF_COLOR_RED);
+    const Texture* t = text_cache_get(ctx->state.text_textures, ctx->renderer, font, text, color);
+    if (!t) return;
 
-        SDL_Surface* surface;
-        SDL_Texture* texture;
+    SDL_FRect dst = {x, y, t->w, t->h};
+    SDL_RenderTexture(ctx->renderer, t->tex, NULL, &dst);
+}
 
-        surface = TTF_RenderText_Blended(font, text, 0, color);
-        if (!surface) return;
+void camera_layout(state_t& s, ImVec2 origin, ImVec2 view) {
+    zone_scoped_n("camera layout");
 
-        texture = SDL_CreateTextureFromSurface(ctx->renderer, surface);
-        if (texture) {
-            SDL_FRect dst = {x, y, (float)surface->w, (float)surface->h};
+    auto& cam = s.camera;
+    if (cam.board_w != s.game.width || cam.board_h != s.game.height) {
+        cam.zoom = 1.0f;
+        cam.pan = {0, 0};
+        cam.board_w = s.game.width;
+        cam.board_h = s.game.height;
+    }
+    cam.origin = origin;
+    cam.view = view;
+
+    float fit_size = std::min(view.x, view.y);
+    s.cell_size = fit_size / s.game.width * cam.zoom;
+    if (s.cell_size <= 0.0f) {
+        cam.x0 = cam.y0 = cam.x1 = cam.y1 = 0;
+        return;
+    }
 
-            SDL_RenderTexture(ctx->renderer, texture, NULL, &dst);
+    // the centre of the game area always stays over the board
+    float board_w = s.cell_size * s.game.width;
+    float board_h = s.cell_size * s.game.height;
+    cam.pan.x = std::clamp(cam.pan.x, -board_w / 2, board_w / 2);
+    cam.pan.y = std::clamp(cam.pan.y, -board_h / 2, board_h / 2);
 
-            ctx->state.font_texture_cache[key] =
-                Texture{texture, (float)surface->w, (float)surface->h};
-        }
-        SDL_DestroySurface(surface);
-    } else {
-        zone_scoped_nc("cache hit", PROF_COLOR_GREEN);
+    s.offset = {
+        (view.x - board_w) / 2 + cam.pan.x,
+        (view.y - board_h) / 2 + cam.pan.y,
+    };
 
-        SDL_FRect dst = {x, y, (float)it->second.w, (float)it->second.h};
-        SDL_RenderTexture(ctx->renderer, it->second.tex, NULL, &dst);
+    auto first = [&](float offset, size_t count) {
+        return (size_t)std::clamp(std::floor(-offset / s.cell_size), 0.0f, (float)count);
+    };
+    auto last = [&](float offset, float size, size_t count) {
+        return (size_t)std::clamp(std::ceil((size - offset) / s.cell_size), 0.0f, (float)count);
+    };
+
+    cam.x0 = first(s.offset.x, s.game.width);
+    cam.y0 = first(s.offset.y, s.game.height);
+    cam.x1 = last(s.offset.x, view.x, s.game.width);
+    cam.y1 = last(s.offset.y, view.y, s.game.height);
+}
+
+// below this many pixels a cell has no room for its border, circle or text
+constexpr float OVERVIEW_CELL_SIZE = 4.0f;
+
+static uint32_t overview_texel(cell::type_t type) {
+    // RGBA8888, the same colours the detailed cells use
+    switch (type) {
+        case cell::black:
+            return 0x000000ffu;
+        case cell::white:
+            return 0xffffffffu;
+        case cell::blank:
+            break;
     }
+    return 0x505050ffu;
 }
 
-void draw_grid(ctx_t* ctx) {
-    zone_scoped_n("draw grid");
+// the whole board as one quad over a streaming texture, only rows that changed since the last
+// upload are sent. false when the texture can't be had, the caller draws the cells instead
+static bool draw_grid_overview(ctx_t* ctx) {
+    zone_scoped_n("draw grid overview");
 
-    float delay_duration = 1.0f;
-    float fade_speed = 2.0f;
     auto& s = ctx->state;
+    auto& ov = ctx->overview;
+    int w = (int)s.game.width;
+    int h = (int)s.game.height;
+
+    if (!ov.tex.tex || ov.tex.w != w || ov.tex.h != h) {
+        ov.tex.free();
+        ov.tex.tex = SDL_CreateTexture(
+            ctx->renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+        if (!ov.tex.tex) {
+            SDL_Log("Failed to create overview texture: %s", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureScaleMode(ov.tex.tex, SDL_SCALEMODE_NEAREST);
+        ov.tex.w = (float)w;
+        ov.tex.h = (float)h;
 
-    for (const auto& item : s.game.items()) {
-        zone_scoped_n("draw cell");
-        // zone_text("draw cell (%d : %d)", item.position.x, item.position.y);
+        // no cell colour has a zero alpha, so every row counts as changed
+        ov.texels.assign((size_t)w * h, 0);
+        ov.valid = false;
+    }
 
-        ktl::pos2_size pos = item.position;
-        SDL_FRect dest = grid_cell_rect(s, pos);
-        ImVec2 center = grid_cell_center(s, pos);
+    if (!ov.valid || ov.hash != s.hash) {
+        zone_scoped_n("upload changed rows");
+
+        // consecutive changed rows go up in one update
+        int run_start = -1;
+        auto flush = [&](int end) {
+            if (run_start < 0) return;
+            SDL_Rect rect = {0, run_start, w, end - run_start};
+            SDL_UpdateTexture(ov.tex.tex, &rect, &ov.texels[(size_t)run_start * w], w * 4);
+            run_start = -1;
+        };
+
+        for (int y = 0; y < h; y++) {
+            uint32_t* row = &ov.texels[(size_t)y * w];
+            bool changed = false;
+            for (int x = 0; x < w; x++) {
+                uint32_t t = overview_texel(s.game.at((size_t)x, (size_t)y).type);
+                changed |= row[x] != t;
+                row[x] = t;
+            }
 
-        SDL_Color cell_color = {245, 245, 245, 255};
-        switch (item.value.type) {
-            case cell::black:
-                cell_color = {0, 0, 0, 255};
-                break;
-            case cell::white:
-                cell_color = {255, 255, 255, 255};
-                break;
-            case cell::blank:
-                cell_color = {80, 80, 80, 255};
-                break;
+            if (changed && run_start < 0) run_start = y;
+            if (!changed) flush(y);
         }
+        flush(h);
+
+        ov.hash = s.hash;
+        ov.valid = true;
+    }
+
+    SDL_FRect dst = grid_region_rect(s, {0, 0}, {s.game.width, s.game.height});
+    SDL_RenderTexture(ctx->renderer, ov.tex.tex, nullptr, &dst);
+    return true;
+}
+
+// the detailed board through the renderer, a fill, an outline and maybe a circle per cell
+static void draw_grid_cells(ctx_t* ctx) {
+    zone_scoped_n("draw grid cells");
+
+    auto& s = ctx->state;
+
+    // every mistake circle of the frame goes out in one geometry call after the cells
+    static thread_local disc_batch mistake_discs;
+
+    // only the cells on screen, a zoomed in large board costs what the screen shows
+    for (size_t y = s.camera.y0; y < s.camera.y1; y++) {
+        for (size_t x = s.camera.x0; x < s.camera.x1; x++) {
+            zone_scoped_n("draw cell");
+            // zone_text("draw cell (%d : %d)", x, y);
+
+            ktl::pos2_size pos = {x, y};
+            SDL_FRect dest = grid_cell_rect(s, pos);
+
+            SDL_Color cell_color = {245, 245, 245, 255};
+            switch (s.game.at(pos).type) {
+                case cell::black:
+                    cell_color = {0, 0, 0, 255};
+                    break;
+                case cell::white:
+                    cell_color = {255, 255, 255, 255};
+                    break;
+                case cell::blank:
+                    cell_color = {80, 80, 80, 255};
+                    break;
+            }
+
+            set_render_color(ctx->renderer, cell_color);
+            {
+                zone_scoped_n("render cell bg");
+                SDL_RenderFillRect(ctx->renderer, &dest);
+            }
+
+            set_render_color(ctx->renderer, {0, 0, 0, 255});
+            {
+                zone_scoped_n("render cell border");
+                SDL_RenderRect(ctx->renderer, &dest);
+            }
 
-        set_render_color(ctx->renderer, cell_color);
-        {
-            zone_scoped_n("render cell bg");
-            SDL_RenderFillRect(ctx->renderer, &dest);
         }
+    }
+
+    for (const auto& f : ctx->fades.active) {
+        ktl::pos2_size pos = {f.index % s.game.width, f.index / s.game.width};
+        if (f.alpha <= 0.0f || !is_visible(s, pos)) continue;
+
+        ImVec2 center = grid_cell_center(s, pos);
+        SDL_Color animated_red = {255, 0, 0, (uint8_t)fade(255, f.alpha)};
+        float radius = (s.cell_size / 2) - (s.cell_size / 10);
+        disc_batch_add(mistake_discs, center.x, center.y, radius, animated_red);
+    }
+    disc_batch_flush(ctx->renderer, mistake_discs);
+
+    int font_size = static_cast<int>(s.cell_size * 0.6f);
+    auto font = get_font(s, font_size);
+
+    // the table is row major, so the visible rows are one contiguous run of it
+    auto first_visible = std::lower_bound(s.observers.begin(),
+        s.observers.end(),
+        ktl::pos2_size{0, s.camera.y0},
+        observer_before);
+
+    for (auto it = first_visible; it != s.observers.end() && it->pos.y < s.camera.y1; ++it) {
+        const observer& o = *it;
+        if (o.pos.x < s.camera.x0 || o.pos.x >= s.camera.x1) continue;
+        if (s.game.at(o.pos).type != cell::white) continue;
 
-        set_render_color(ctx->renderer, {0, 0, 0, 255});
+        zone_scoped_n("text measuring");
+
+        ImVec2 center = grid_cell_center(s, o.pos);
+
+        const char* text;
         {
-            zone_scoped_n("render cell border");
-            SDL_RenderRect(ctx->renderer, &dest);
+            zone_scoped_n("formatting");
+            text = frame_printf("%d", o.value);
         }
 
-        if (item.value.mistake) {
-            if (item.value.mistake_delay > 0) {
-                item.value.mistake_delay -= s.dt;
-            } else {
-                item.value.mistake_alpha =
-                    fminf(item.value.mistake_alpha + s.dt * fade_speed, 1.0f);
-            }
-        } else {
-            item.value.mistake_delay = delay_duration;
-            item.value.mistake_alpha = 0.0f;
+        auto text_color = o.satisfied ? SDL_Color{130, 130, 130, 255} : SDL_Color{0, 0, 0, 255};
+
+        int ascent, descent;
+        {
+            zone_scoped_n("query font params");
+            ascent = TTF_GetFontAscent(font);
+            descent = TTF_GetFontDescent(font);
         }
+        int visual_height = ascent - descent;
 
-        if (item.value.mistake_alpha > 0.0f) {
-            SDL_Color animated_red = {255, 0, 0, (uint8_t)fade(255, item.value.mistake_alpha)};
-            float radius = (s.cell_size / 2) - (s.cell_size / 10);
-            draw_filled_circle(ctx->renderer, center.x, center.y, radius, animated_red);
+        int advance_w = 0;
+        int advance_h = 0;
+        {
+            zone_scoped_n("get string size");
+            TTF_GetStringSize(font, text, 0, &advance_w, &advance_h);
         }
 
-        if (item.value.type == cell::white && item.value.observer_value != -1) {
-            zone_scoped_n("text measuring");
+        float textX = center.x - advance_w * 0.5f;
+        float textY = center.y - advance_h * 0.5f;
 
-            char* text;
-            {
-                zone_scoped_n("formatting");
-                SDL_asprintf(&text, "%d", item.value.observer_value);
-            }
+        draw_text(ctx, font, text, textX, textY, text_color);
+    }
+}
 
-            int font_size = static_cast<int>(s.cell_size * 0.6f);
-            auto font = get_font(s, font_size);
+void draw_grid(ctx_t* ctx) {
+    zone_scoped_n("draw grid");
 
-            auto text_color = item.value.observer_satisfied ? SDL_Color{130, 130, 130, 255}
-                                                            : SDL_Color{0, 0, 0, 255};
+    auto& s = ctx->state;
+    uint64_t start = ctx->time_board ? SDL_GetPerformanceCounter() : 0;
 
-            int ascent, descent;
-            {
-                zone_scoped_n("query font params");
-                ascent = TTF_GetFontAscent(font);
-                descent = TTF_GetFontDescent(font);
-            }
-            int visual_height = ascent - descent;
+    mistake_fades_update(ctx->fades, s);
 
-            int advance_w = 0;
-            int advance_h = 0;
-            {
-                zone_scoped_n("get string size");
-                TTF_GetStringSize(font, text, 0, &advance_w, &advance_h);
-            }
+    if (s.cell_size < OVERVIEW_CELL_SIZE && draw_grid_overview(ctx)) {
+        ctx->board_path = "overview";
+    } else if (ctx->raster->enabled && raster_board(ctx)) {
+        ctx->board_path = "cpu raster";
+    } else {
+        draw_grid_cells(ctx);
+        ctx->board_path = "renderer";
+    }
 
-            float textX = center.x - advance_w * 0.5f;
-            float textY = center.y - advance_h * 0.5f;
+    if (!ctx->time_board) return;
 
-            draw_text(ctx, font, text, textX, textY, text_color);
-            SDL_free(text);
-        }
-    }
+    // the renderer queues its commands, flushing makes the software renderer do its work inside
+    // the timed span so both paths are measured the same way
+    SDL_FlushRenderer(ctx->renderer);
+    ctx->board_ms =
+        (float)((SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
 }
 
 void draw_tooltip(ctx_t* ctx, const char* text, ImVec2 pos, ImVec2 render_size) {
@@ -299,10 +469,8 @@ void draw_measure_overlay(ctx_t* ctx, ImVec2 window_origin, ImVec2 render_size)
     SDL_RenderRect(ctx->renderer, &s.measure.rect);
 
     ImVec2 rel_mouse = get_relative_mouse(s, window_origin);
-    char* txt;
-    SDL_asprintf(&txt, "%.0f, %.0f", s.measure.dims.w, s.measure.dims.h);
+    const char* txt = frame_printf("%.0f, %.0f", s.measure.dims.w, s.measure.dims.h);
     draw_tooltip(ctx, txt, rel_mouse, render_size);
-    SDL_free(txt);
 }
 
 void draw_erase_overlay(ctx_t* ctx) {
@@ -322,20 +490,24 @@ void draw_erase_overlay(ctx_t* ctx) {
 void debug_overlay(ctx_t* ctx, ImVec2 pos) {
     zone_scoped_n("debug overlay");
 
-    static std::vector<float> frame_times;
-    static float time_sum = 0.0f;
+    // ring of the last frame times, the oldest is overwritten in place
     constexpr int MAX_SAMPLES = 120;
+    static float frame_times[MAX_SAMPLES];
+    static int next_sample = 0;
+    static int sample_count = 0;
+    static float time_sum = 0.0f;
 
     float dt_ms = ctx->state.dt * 1000.0f;
-    frame_times.push_back(dt_ms);
-    time_sum += dt_ms;
-
-    if (frame_times.size() > MAX_SAMPLES) {
-        time_sum -= frame_times.front();
-        frame_times.erase(frame_times.begin());
+    if (sample_count == MAX_SAMPLES) {
+        time_sum -= frame_times[next_sample];
+    } else {
+        sample_count++;
     }
+    frame_times[next_sample] = dt_ms;
+    next_sample = (next_sample + 1) % MAX_SAMPLES;
+    time_sum += dt_ms;
 
-    const float avg_ms = time_sum / static_cast<float>(frame_times.size());
+    const float avg_ms = time_sum / static_cast<float>(sample_count);
     const float avg_fps = (avg_ms > 0.0001f) ? 1000.0f / avg_ms : 0.0f;
 
     ImDrawList* draw_list = ImGui::GetForegroundDrawList();
@@ -376,6 +548,56 @@ void debug_overlay(ctx_t* ctx, ImVec2 pos) {
 
     print(color, "%s", get_memory_usage_str_mb());
 
+    generation_stats gen = get_generation_stats();
+    print(color,
+        "generator: %llu accepted of %llu candidates",
+        (unsigned long long)gen.accepted,
+        (unsigned long long)gen.candidates);
+
+    print(color, "board %016llx", (unsigned long long)ctx->state.hash);
+    if (ctx->time_board) {
+        print(color, "board drawn in %.2f ms (%s)", ctx->board_ms, ctx->board_path);
+    } else {
+        print(color, "board drawn by %s", ctx->board_path);
+    }
+
+    const text_cache* texts = ctx->state.text_textures;
+    print(color,
+        "text cache: %zu textures, %.1f of %.1f MB",
+        texts->lru.size(),
+        texts->bytes / (1024.0 * 1024.0),
+        texts->budget / (1024.0 * 1024.0));
+    print(color,
+        "text cache: %llu hits, %llu misses, %llu evicted",
+        (unsigned long long)texts->hits,
+        (unsigned long long)texts->misses,
+        (unsigned long long)texts->evictions);
+
+    if (ctx->state.endless) {
+        const endless_world& w = *ctx->state.endless;
+        print(color,
+            "endless: %zu tiles, %llu built, %llu restored, %llu evicted",
+            w.tiles.size(),
+            (unsigned long long)w.built,
+            (unsigned long long)w.restored,
+            (unsigned long long)w.evicted);
+    }
+
+#if defined(KUROMASU_ALLOC_TRACKING)
+    alloc_counters frame_allocs = alloc_tracking_last_frame();
+    alloc_counters total_allocs = alloc_tracking_total();
+
+    print(frame_allocs.allocs == 0 ? color : IM_COL32(255, 220, 80, 255),
+        "heap allocs/frame: %llu (%llu B), frees: %llu",
+        (unsigned long long)frame_allocs.allocs,
+        (unsigned long long)frame_allocs.bytes,
+        (unsigned long long)frame_allocs.frees);
+    print(color,
+        "heap allocs total: %llu (%.2f MB)",
+        (unsigned long long)total_allocs.allocs,
+        total_allocs.bytes / (1024.0 * 1024.0));
+#endif
+
     ImGuiIO& io = ImGui::GetIO();
     bool mouse_valid = ImGui::IsMousePosValid(&io.MousePos);
     float mouse_x = mouse_valid ? io.MousePos.x : 0.0f;
@@ -384,7 +606,9 @@ void debug_overlay(ctx_t* ctx, ImVec2 pos) {
     print(color, "Mouse %.0f, %.0f", mouse_x, mouse_y);
 
 #if !defined(NDEBUG)
-    print(color, "regions created: %d", g_arena.region_creations);
-    print(color, "cross regions allocations: %d", g_arena.allocations_bigger_than_region_size);
+    print(color, "frame regions created: %d", g_frame_arena.region_creations);
+    print(color,
+        "frame cross regions allocations: %d",
+        g_frame_arena.allocations_bigger_than_region_size);
 #endif
 }
\ No newline at end of file
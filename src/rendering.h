@@ -2,7 +2,6 @@
 #define RENDERING_H
 
 #include "common.h"
-#include <string>
 
 ImVec2 grid_to_screen_pos(const state_t& s, int grid_x, int grid_y);
 ImVec2 grid_to_screen_pos(const state_t& s, ktl::pos2_size grid_pos);
@@ -40,6 +39,16 @@ inline SDL_Color fade(SDL_Color color, float alpha) {
     return result;
 }
 
+// filled circles gathered over a frame and submitted in a single geometry call
+struct disc_batch {
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+void disc_batch_add(disc_batch& b, float center_x, float center_y, float radius, SDL_Color color);
+// draws everything added since the last flush, the batch keeps its storage for the next frame
+void disc_batch_flush(SDL_Renderer* renderer, disc_batch& b);
+
 void draw_filled_circle(SDL_Renderer* renderer,
     float centerX,
     float centerY,
@@ -48,12 +57,12 @@ void draw_filled_circle(SDL_Renderer* renderer,
 
 void draw_text(ctx_t* ctx, TTF_Font* font, const char* text, float x, float y, SDL_Color color);
 
-inline int64_t get_font_cache_key(TTF_Font* font, const char* text, SDL_Color color) {
-    size_t h = std::hash<std::string>{}(text);
-    h ^= std::hash<void*>{}(font) + 0x9e3779b9 + (h << 6) + (h >> 2);
-    uint32_t color_packed = (color.r << 24) | (color.g << 16) | (color.b << 8) | color.a;
-    h ^= std::hash<uint32_t>{}(color_packed) + 0x9e3779b9 + (h << 6) + (h >> 2);
-    return (int64_t)h;
+// lays the board out in a game area of size view at origin, following s.camera. resets the camera
+// when the board changes size
+void camera_layout(state_t& s, ImVec2 origin, ImVec2 view);
+
+inline bool is_visible(const state_t& s, ktl::pos2_size p) {
+    return p.x >= s.camera.x0 && p.x < s.camera.x1 && p.y >= s.camera.y0 && p.y < s.camera.y1;
 }
 
 void draw_grid(ctx_t* ctx);
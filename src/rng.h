@@ -0,0 +1,86 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+#include <algorithm>
+
+// counter based random numbers: every draw is a pure function of (key, counter), so a board is
+// bit identical on every platform and standard library, and draws for different cells do not
+// depend on the order they are taken in. based on the Squares generator (Widynski 2020)
+
+inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+inline uint32_t squares32(uint64_t ctr, uint64_t key) {
+    uint64_t x, y, z;
+    y = x = ctr * key;
+    z = y + key;
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    x = x * x + z;
+    x = (x >> 32) | (x << 32);
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    return (uint32_t)((x * x + z) >> 32);
+}
+
+inline uint64_t squares64(uint64_t ctr, uint64_t key) {
+    uint64_t t, x, y, z;
+    y = x = ctr * key;
+    z = y + key;
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    x = x * x + z;
+    x = (x >> 32) | (x << 32);
+    x = x * x + y;
+    x = (x >> 32) | (x << 32);
+    t = x = x * x + z;
+    x = (x >> 32) | (x << 32);
+    return t ^ ((x * x + y) >> 32);
+}
+
+// independent streams of draws under the same key, one per generation phase
+enum rng_stream : uint64_t {
+    RNG_STREAM_BLACK = 1,
+    RNG_STREAM_OBSERVER = 2,
+    RNG_STREAM_ZOBRIST = 3,
+    RNG_STREAM_MINIMIZE = 4,
+    RNG_STREAM_DIFFICULTY = 5,
+};
+
+struct counter_rng {
+    uint64_t key = 1;
+
+    counter_rng() = default;
+    explicit counter_rng(uint64_t seed) : key(splitmix64(seed) | 1) {}
+
+    // the top 16 bits select the stream, the rest index the draw (usually a cell index)
+    static uint64_t counter(uint64_t stream, uint64_t index) {
+        return (stream << 48) | (index & 0xffffffffffffull);
+    }
+
+    uint32_t u32(uint64_t stream, uint64_t index) const {
+        return squares32(counter(stream, index), key);
+    }
+
+    uint64_t u64(uint64_t stream, uint64_t index) const {
+        return squares64(counter(stream, index), key);
+    }
+
+    // compares against a threshold from chance_threshold(), true with the given probability
+    bool chance(uint64_t stream, uint64_t index, uint64_t threshold) const {
+        return u32(stream, index) < threshold;
+    }
+};
+
+// maps a percentage onto the 32 bit draw range, 100% maps past the largest draw so it always hits
+inline uint64_t chance_threshold(float percent) {
+    double p = std::clamp((double)percent, 0.0, 100.0) / 100.0;
+    return (uint64_t)(p * 4294967296.0);
+}
+
+#endif /* RNG_H */
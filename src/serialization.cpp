@@ -15,16 +15,22 @@ std::string marshal(ctx_t* ctx) {
     json doc;
 
     doc["version"] = KUROMASU_SAVE_VERSION;
+    doc["generator"] = KUROMASU_GENERATOR_VERSION;
     doc["seed"] = ctx->state.seed;
     doc["width"] = ctx->state.starting_pos.width;
     doc["height"] = ctx->state.starting_pos.height;
     doc["black_chance"] = ctx->state.black_chance;
     doc["observer_chance"] = ctx->state.observer_chance;
+    if (ctx->state.minimize) { doc["minimize"] = true; }
+    if (ctx->state.difficulty_target.enabled) {
+        doc["difficulty"] = {ctx->state.difficulty_target.min, ctx->state.difficulty_target.max};
+    }
 
     std::vector<obs> observers;
+    observers.reserve(ctx->state.observers.size());
 
-    for (auto&& [cell, pos] : ctx->state.starting_pos.items()) {
-        if (cell.observer_value != -1) { observers.push_back({pos.x, pos.y, cell.observer_value}); }
+    for (auto& o : ctx->state.observers) {
+        observers.push_back({o.pos.x, o.pos.y, o.value});
     }
 
     doc["observers"] = observers;
@@ -48,6 +54,13 @@ marshal_error unmarshal(ctx_t* ctx, std::string data, bool force) {
 
         uint32_t file_version = doc["version"].get<uint32_t>();
         if (file_version > KUROMASU_SAVE_VERSION) { return marshal_error::FORMAT_VERSION_NEWER; }
+
+        // saves without a tag come from the generator before it went counter based
+        uint32_t generator = 1;
+        if (doc.contains("generator") && doc["generator"].is_number_unsigned()) {
+            generator = doc["generator"].get<uint32_t>();
+        }
+        if (generator != KUROMASU_GENERATOR_VERSION) { return marshal_error::GENERATOR_MISMATCH; }
     }
 
     if (!doc.contains("seed") || !doc["seed"].is_number_unsigned()) {
@@ -64,7 +77,7 @@ marshal_error unmarshal(ctx_t* ctx, std::string data, bool force) {
     size_t loaded_h = doc["height"].get<size_t>();
 
     ctx->state.game.resize(loaded_w, loaded_h);
-    ctx->state.game.fill(cell{.type = cell::blank, .observer_value = -1});
+    ctx->state.game.fill(cell{.type = cell::blank});
 
     if (doc.contains("black_chance")) {
         if (!doc["black_chance"].is_number()) { return marshal_error::WRONG_DATA; }
@@ -80,8 +93,30 @@ marshal_error unmarshal(ctx_t* ctx, std::string data, bool force) {
         ctx->state.observer_chance = oc;
     }
 
-    generate_board(
-        ctx->state, ctx->state.seed, ctx->state.black_chance, ctx->state.observer_chance);
+    bool minimize = false;
+    if (doc.contains("minimize")) {
+        if (!doc["minimize"].is_boolean()) { return marshal_error::WRONG_DATA; }
+        minimize = doc["minimize"].get<bool>();
+    }
+
+    generation_params params = {
+        .width = loaded_w,
+        .height = loaded_h,
+        .black_chance = ctx->state.black_chance,
+        .observer_chance = ctx->state.observer_chance,
+        .minimize = minimize,
+    };
+
+    if (doc.contains("difficulty")) {
+        const auto& band = doc["difficulty"];
+        if (!band.is_array() || band.size() != 2 || !band[0].is_number() || !band[1].is_number()) {
+            return marshal_error::WRONG_DATA;
+        }
+        params.difficulty = {
+            .enabled = true, .min = band[0].get<float>(), .max = band[1].get<float>()};
+    }
+
+    apply_puzzle(ctx->state, generate_puzzle(params, ctx->state.seed));
 
     if (doc.contains("observers") && doc["observers"].is_array()) {
         const auto& arr = doc["observers"];
@@ -96,8 +131,11 @@ marshal_error unmarshal(ctx_t* ctx, std::string data, bool force) {
 
             auto pos = ktl::pos2_size{x, y};
 
-            if (!ctx->state.game.in_bounds(pos)) differences++;
-            if (!ctx->state.game.xy(x, y).observer_value == val) differences++;
+            if (!ctx->state.game.in_bounds(pos)) {
+                differences++;
+                continue;
+            }
+            if (observer_value(ctx->state.observers, pos) != val) differences++;
         }
 
         if (differences != 0) return marshal_error::GENERATION_DIFFERS;
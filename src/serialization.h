@@ -7,7 +7,7 @@
 
 #include "common.h"
 
-#define KUROMASU_SAVE_VERSION 1  // backwards compatible, forwards incompatible
+#define KUROMASU_SAVE_VERSION 2  // backwards compatible, forwards incompatible
 
 enum class marshal_error {
     OK,
@@ -15,7 +15,8 @@ enum class marshal_error {
     NO_VERSION,
     WRONG_DATA,
     INVALID_JSON,
-    GENERATION_DIFFERS
+    GENERATION_DIFFERS,
+    GENERATOR_MISMATCH
 };
 
 inline const char* get_marshal_error_message(marshal_error err) noexcept {
@@ -32,6 +33,8 @@ inline const char* get_marshal_error_message(marshal_error err) noexcept {
             return "Invalid JSON structure";
         case marshal_error::GENERATION_DIFFERS:
             return "Generated board is different than saved state";
+        case marshal_error::GENERATOR_MISMATCH:
+            return "Board was saved by a different board generator";
 
         default:
             return "n/a";
@@ -1,11 +1,16 @@
 #include "kuromasu.h"
+#include "bitboard.h"
 
-raycast_res raycast_direction_non_black(state_t& s, ktl::pos2_size p, size_t dx, size_t dy) {
+raycast_res raycast_direction_non_black(state_t& s,
+    ktl::pos2_size p,
+    size_t dx,
+    size_t dy,
+    size_t max_steps) {
     raycast_res res;
     int cx = (int)p.x + dx;
     int cy = (int)p.y + dy;
 
-    while (s.game.in_bounds(cx, cy)) {
+    for (size_t step = 0; step < max_steps && s.game.in_bounds(cx, cy); step++) {
         cell c = s.game.at((size_t)cx, (size_t)cy);
 
         switch (c.type) {
@@ -42,7 +47,7 @@ bool are_adjacent(const ktl::pos2_size& a, const ktl::pos2_size& b) {
 }
 
 std::pair<ktl::pos2_size, ktl::pos2_size> find_adjacent_pair(
-    const std::vector<ktl::pos2_size>& positions) {
+    const frame_vector<ktl::pos2_size>& positions) {
     if (positions.size() < 2) return {ktl::pos2_size::invalid(), ktl::pos2_size::invalid()};
 
     for (size_t i = 0; i < positions.size(); ++i) {
@@ -59,48 +64,44 @@ void solve(state_t& s) {
 
     // reset
     s.solved = false;
-    for (auto&& [c, pos] : s.game.items()) {
-        c.mistake = false;
-        c.observer_satisfied = false;
+    s.mistakes.assign(s.game.width * s.game.height, 0);
+    s.mistakes_version++;
+    for (auto& o : s.observers) {
+        o.satisfied = false;
     }
 
     // 1. check if all observers can see their amount
-    s.game.traverse(
-        {0, 0},
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            return c.type == cell::white && c.observer_value != -1;
-        },
-        [&](cell& c, ktl::pos2_size p) -> bool {
-            int visible = 1;
-            bool all_closed = true;
-            constexpr std::array<direction, 4> dirs = {
-                direction{-1, 0}, direction{1, 0}, direction{0, -1}, direction{0, 1}};
+    for (auto& o : s.observers) {
+        if (s.game.at(o.pos).type != cell::white) continue;
 
-            for (auto [dx, dy] : dirs) {
-                auto r = raycast_direction_non_black(s, p, dx, dy);
-                visible += r.white_count;
+        int visible = 1;
+        bool all_closed = true;
 
-                if (!r.closed) { all_closed = false; }
-            }
+        // walking past `reach` can only confirm the observer already sees too much
+        for (int d = 0; d < 4; d++) {
+            auto r = raycast_direction_non_black(s, o.pos, ray_dx[d], ray_dy[d], o.reach[d]);
+            visible += r.white_count;
+
+            if (!r.closed) { all_closed = false; }
+        }
 
-            bool is_mistake = false;
+        bool is_mistake = false;
 
-            if (all_closed) {
-                if (visible != c.observer_value) {
-                    is_mistake = true;
-                } else {
-                    c.observer_satisfied = true;
-                }
+        if (all_closed) {
+            if (visible != o.value) {
+                is_mistake = true;
             } else {
-                if (visible > c.observer_value) { is_mistake = true; }
+                o.satisfied = true;
             }
+        } else {
+            if (visible > o.value) { is_mistake = true; }
+        }
 
-            c.mistake = is_mistake;
-            return !is_mistake;
-        });
+        s.mistakes[cell_index(s.game, o.pos)] = is_mistake;
+    }
 
     // 2. check if any 2 black are next to each other
-    std::vector<ktl::pos2_size> pos;
+    auto pos = make_frame_vector<ktl::pos2_size>();
     s.game.traverse(
         {0, 0},
         [&](cell& c, ktl::pos2_size p) -> bool { return c.type == cell::black; },
@@ -112,34 +113,57 @@ void solve(state_t& s) {
     auto wrong = find_adjacent_pair(pos);
 
     if (wrong.first != ktl::pos2_size::invalid() || wrong.second != ktl::pos2_size::invalid()) {
-        s.game.at(wrong.first).mistake = true;
-        s.game.at(wrong.second).mistake = true;
+        s.mistakes[cell_index(s.game, wrong.first)] = true;
+        s.mistakes[cell_index(s.game, wrong.second)] = true;
+    }
+
+    // 3. check if all white are connected. blanks may still turn white so they carry the flood
+    // too, whites cut off from the region holding most of them are the mistakes
+    static thread_local bit_plane white, open, remaining, region, main_region;
+    white.resize(s.game.width, s.game.height);
+    open.resize(s.game.width, s.game.height);
+    for (auto&& [c, pos] : s.game.items()) {
+        if (c.type == cell::white) white.set(pos.x, pos.y);
+        if (c.type != cell::black) open.set(pos.x, pos.y);
     }
 
-    // 3. check if all white are connected
-    auto is_white = [&](cell& c, ktl::pos2_size) -> bool { return c.type == cell::white; };
-    auto is_white_or_blank = [&](cell& c, ktl::pos2_size) -> bool {
-        return c.type == cell::white || c.type == cell::blank;
-    };
+    remaining = white;
+    size_t left = plane_count(remaining);
+    size_t most = 0;
+    size_t regions = 0;
+    for (size_t x, y; plane_first(remaining, x, y); regions++) {
+        region.resize(s.game.width, s.game.height);
+        region.set(x, y);
+        flood_plane(region, open);
+        plane_and_not(remaining, region);
+
+        size_t now = plane_count(remaining);
+        if (left - now > most) {
+            most = left - now;
+            std::swap(main_region, region);
+        }
+        left = now;
+    }
 
-    if (!s.game.is_connected(is_white_or_blank)) {
-        ktl::pos2_size start;
+    if (regions > 1) {
         for (auto&& [c, pos] : s.game.items()) {
-            if (is_white(c, pos)) { c.mistake = true; }
+            if (c.type == cell::white && !main_region.test(pos.x, pos.y)) {
+                s.mistakes[cell_index(s.game, pos)] = true;
+            }
         }
     }
 
     // 4. check if all blanks can be white, and no black are replaced with white
-    std::vector<ktl::pos2_size> blanks;
+    auto blanks = make_frame_vector<ktl::pos2_size>();
     int count = 0;
     int mistake_count = 0;
     for (auto&& [c, pos] : s.game.items()) {
-        if (c.mistake) { mistake_count++; }
+        if (s.mistakes[cell_index(s.game, pos)]) { mistake_count++; }
         if (c.type == cell::blank) { blanks.push_back(pos); }
 
         if (c.type == cell::white) {
             if (s.solved_state.at(pos).type == cell::black) {
-                c.mistake = true;
+                s.mistakes[cell_index(s.game, pos)] = true;
                 mistake_count++;
             }
         }
@@ -0,0 +1,99 @@
+#include "text_cache.h"
+
+size_t text_key_hash::operator()(const text_key& k) const {
+    size_t h = std::hash<std::string>{}(k.text);
+    h ^= std::hash<void*>{}(k.font) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<uint32_t>{}(k.color) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+static void evict_back(text_cache* c) {
+    auto& e = c->lru.back();
+    c->bytes -= e.bytes;
+    e.tex.free();
+    c->index.erase(e.key);
+    c->lru.pop_back();
+    c->evictions++;
+}
+
+static void evict_to(text_cache* c, size_t budget) {
+    while (!c->lru.empty() && c->bytes > budget) {
+        evict_back(c);
+    }
+}
+
+text_cache* text_cache_create(size_t budget) {
+    auto* c = new text_cache();
+    c->budget = budget;
+    return c;
+}
+
+void text_cache_destroy(text_cache* c) {
+    if (!c) return;
+
+    for (auto& e : c->lru) {
+        e.tex.free();
+    }
+    delete c;
+}
+
+const Texture* text_cache_get(text_cache* c,
+    SDL_Renderer* renderer,
+    TTF_Font* font,
+    const char* text,
+    SDL_Color color) {
+    text_key key = {
+        .font = font,
+        .color = (uint32_t)((color.r << 24) | (color.g << 16) | (color.b << 8) | color.a),
+        .text = text,
+    };
+
+    auto it = c->index.find(key);
+    if (it != c->index.end()) {
+        zone_scoped_nc("cache hit", PROF_COLOR_GREEN);
+
+        c->hits++;
+        c->lru.splice(c->lru.begin(), c->lru, it->second);
+        return &it->second->tex;
+    }
+
+    zone_scoped_nc("cache miss", PROF_COLOR_RED);
+    c->misses++;
+
+    SDL_Surface* surface = TTF_RenderText_Blended(font, text, 0, color);
+    if (!surface) return nullptr;
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    float w = (float)surface->w, h = (float)surface->h;
+    SDL_DestroySurface(surface);
+    if (!texture) return nullptr;
+
+    size_t bytes = (size_t)w * (size_t)h * 4;
+
+    // make room first, a texture bigger than the whole budget stays alone until the next miss
+    evict_to(c, bytes < c->budget ? c->budget - bytes : 0);
+
+    c->lru.push_front({.key = std::move(key), .tex = {texture, w, h}, .bytes = bytes});
+    c->index.emplace(c->lru.front().key, c->lru.begin());
+    c->bytes += bytes;
+    return &c->lru.front().tex;
+}
+
+void text_cache_set_budget(text_cache* c, size_t budget) {
+    c->budget = budget;
+    evict_to(c, budget);
+}
+
+void text_cache_forget_font(text_cache* c, TTF_Font* font) {
+    for (auto it = c->lru.begin(); it != c->lru.end();) {
+        if (it->key.font != font) {
+            ++it;
+            continue;
+        }
+
+        c->bytes -= it->bytes;
+        it->tex.free();
+        c->index.erase(it->key);
+        it = c->lru.erase(it);
+    }
+}
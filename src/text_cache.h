@@ -0,0 +1,62 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <list>
+#include <string>
+#include "common.h"
+
+constexpr size_t TEXT_CACHE_DEFAULT_BUDGET = 16ull * 1024 * 1024;
+
+// rendered text keyed on everything that went into it, compared in full so two strings can never
+// share a texture through a hash collision
+struct text_key {
+    TTF_Font* font = nullptr;
+    uint32_t color = 0;  // RGBA packed
+    std::string text;
+
+    bool operator==(const text_key&) const = default;
+};
+
+struct text_key_hash {
+    size_t operator()(const text_key& k) const;
+};
+
+struct text_cache_entry {
+    text_key key;
+    Texture tex;
+    size_t bytes = 0;
+};
+
+// text textures kept in least recently used order under a byte budget, so text that changes
+// every frame (the measure tooltip) or a font size left behind by a resize ages out instead of
+// piling up for the whole session
+struct text_cache {
+    size_t budget = TEXT_CACHE_DEFAULT_BUDGET;  // bytes of texture memory, 4 per texel
+    size_t bytes = 0;
+
+    std::list<text_cache_entry> lru;  // most recently used first
+    std::unordered_map<text_key, std::list<text_cache_entry>::iterator, text_key_hash> index;
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+text_cache* text_cache_create(size_t budget = TEXT_CACHE_DEFAULT_BUDGET);
+void text_cache_destroy(text_cache* c);
+
+// the texture for text in font and color, rendered on a miss. nullptr when rendering fails, the
+// pointer is good until the next call
+const Texture* text_cache_get(text_cache* c,
+    SDL_Renderer* renderer,
+    TTF_Font* font,
+    const char* text,
+    SDL_Color color);
+
+// evicts down to the new budget right away
+void text_cache_set_budget(text_cache* c, size_t budget);
+
+// drops every texture rendered with font, call before the font is closed
+void text_cache_forget_font(text_cache* c, TTF_Font* font);
+
+#endif /* TEXT_CACHE_H */
@@ -1,11 +1,16 @@
 #include "ui.h"
 #define NOTIFY_RENDER_OUTSIDE_MAIN_WINDOW false
 #include <ImGuiNotify.hpp>
+#include "endless.h"
 #include "external/IconsFontAwesome6.h"
 #include "input.h"
 #include "kuromasu.h"
+#include "pack.h"
+#include "puzzle_queue.h"
+#include "raster.h"
 #include "rendering.h"
 #include "serialization.h"
+#include "zobrist.h"
 
 static const char* info_text =
     R"(The board starts with blank cells and some "Observer" white cells
@@ -21,6 +26,66 @@ static float info_offset = 60.0f;
 static float info_offset = 20.0f;
 #endif
 
+// the file dialog may answer from another thread, the chosen path comes back as a user event
+static Uint32 pack_open_event = 0;
+
+static void SDLCALL on_pack_chosen(void* userdata, const char* const* filelist, int filter) {
+    if (!filelist) {
+        SDL_Log("Pack dialog failed: %s", SDL_GetError());
+        return;
+    }
+    if (!filelist[0]) return;
+
+    SDL_Event e;
+    SDL_zero(e);
+    e.type = pack_open_event;
+    e.user.data1 = SDL_strdup(filelist[0]);
+    if (!SDL_PushEvent(&e)) { SDL_free(e.user.data1); }
+}
+
+static void show_pack_dialog(ctx_t* ctx) {
+    if (pack_open_event == 0) { pack_open_event = SDL_RegisterEvents(1); }
+
+    static const SDL_DialogFileFilter filters[] = {{"Puzzle packs", "kpak"}, {"All files", "*"}};
+    SDL_ShowOpenFileDialog(on_pack_chosen, nullptr, ctx->window, filters, 2, nullptr, false);
+}
+
+void handle_ui_event(ctx_t* ctx, SDL_Event* event) {
+    if (pack_open_event == 0 || event->type != pack_open_event) return;
+
+    char* path = (char*)event->user.data1;
+    auto& state = ctx->state;
+
+    auto* pack = new puzzle_pack();
+    auto err = pack_load(*pack, path);
+    if (err == pack_error::OK && pack->records.empty()) err = pack_error::OUT_OF_RANGE;
+
+    // the first puzzle is opened from the new pack before it replaces anything, a pack that
+    // fails here leaves the board and the old pack as they were
+    const puzzle_t* first = err == pack_error::OK ? pack_get(*pack, 0, &err) : nullptr;
+    if (first) {
+        endless_destroy(state);
+        apply_puzzle(state, *first);
+        delete state.pack;
+        state.pack = pack;
+        state.pack_index = 0;
+    } else {
+        delete pack;
+    }
+
+    if (err == pack_error::OK) {
+        ImGui::InsertNotification({ImGuiToastType::Success,
+            4000,
+            "Loaded pack with %zu puzzles",
+            state.pack->records.size()});
+    } else {
+        ImGui::InsertNotification(
+            {ImGuiToastType::Error, 4000, "Failed to open pack: %s", get_pack_error_message(err)});
+    }
+
+    SDL_free(path);
+}
+
 bool confirm_popup(ctx_t* ctx, const char* title, const char* message, bool* open) {
     zone_scoped_n("draw popup");
 
@@ -163,6 +228,8 @@ void board_controls(ctx_t* ctx) {
 
         if (ImGui::MenuItem(ICON_FA_FILE_IMPORT "Import from clipboard")) {
             char* data = SDL_GetClipboardText();
+            // the window's marks are kept before the board they are read from is replaced
+            endless_destroy(state);
             auto err = unmarshal(ctx, data);
             if (err == marshal_error::OK) {
                 ImGui::InsertNotification(
@@ -175,11 +242,15 @@ void board_controls(ctx_t* ctx) {
             }
         }
 
+        if (ImGui::MenuItem(ICON_FA_BOX_OPEN "Open puzzle pack")) { show_pack_dialog(ctx); }
+
         ImGui::EndPopup();
     }
 
     if (confirm_popup(ctx, "Reset current board ?", "Are you sure ?", &clear_popup)) {
         state.game = state.starting_pos;
+        state.hash = board_hash(state.game, state.observers);
+        solve(state);
     }
 
     ImGui::BeginChild("##scrollable_controls", ImVec2(0, 0), false, ImGuiWindowFlags_None);
@@ -252,6 +323,33 @@ void board_controls(ctx_t* ctx) {
         observer_chance_modified = (ui_observer_chance != state.observer_chance);
     }
 
+    static bool ui_minimize = state.minimize;
+    ImGui::Checkbox("Minimize clues", &ui_minimize);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Remove every observer the others already imply. Only applies to boards "
+                          "that can be solved without guessing.");
+    }
+
+    static difficulty_band ui_difficulty = state.difficulty_target;
+    ImGui::Checkbox("Target difficulty", &ui_difficulty.enabled);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Add or remove observers until the board needs the chosen mix of "
+                          "deductions. 0.5 is only black neighbours, 8 is only trial and error.");
+    }
+
+    if (!ui_difficulty.enabled) ImGui::BeginDisabled();
+    ImGui::SetNextItemWidth(-1);
+    ImGui::DragFloatRange2("##difficulty",
+        &ui_difficulty.min,
+        &ui_difficulty.max,
+        0.01f,
+        0.5f,
+        8.0f,
+        "Min: %.2f",
+        "Max: %.2f",
+        ImGuiSliderFlags_AlwaysClamp);
+    if (!ui_difficulty.enabled) ImGui::EndDisabled();
+
     // Board size controls (preserve user edits across frames)
     static int ui_width = (int)state.game.width;
     static int ui_height = (int)state.game.height;
@@ -297,38 +395,141 @@ void board_controls(ctx_t* ctx) {
 
     int width = ui_width;
     int height = ui_height;
-    if (width < 3) width = 3;
-    if (height < 3) height = 3;
+    width = std::clamp(width, (int)BOARD_MIN_SIDE, (int)BOARD_MAX_SIDE);
+    height = std::clamp(height, (int)BOARD_MIN_SIDE, (int)BOARD_MAX_SIDE);
+
+    generation_params params = {
+        .width = (size_t)width,
+        .height = (size_t)height,
+        .black_chance = ui_black_chance,
+        .observer_chance = ui_observer_chance,
+        .minimize = ui_minimize,
+        .difficulty = ui_difficulty,
+    };
+
+    // keep the prefetched boards in line with what the controls would generate
+    puzzle_queue_configure(state.queue, params);
 
     ImGui::Spacing();
     if (ImGui::Button("Generate", ImVec2(-1, 0))) {
-        std::optional<uint32_t> s;
+        endless_destroy(state);
         if (seed_frozen || seed_modified) {
-            s = ui_seed;
+            apply_puzzle(state, generate_puzzle(params, ui_seed));
         } else {
-            s = std::nullopt;
+            next_puzzle(state);
         }
 
-        // If board size was modified (width or height), resize before generating
-        if (width_modified || height_modified) {
-            state.game.resize(
-                (size_t)width, (size_t)height, cell{.type = cell::blank, .observer_value = -1});
-            state.solved_state.resize(
-                (size_t)width, (size_t)height, cell{.type = cell::blank, .observer_value = -1});
-            width_modified = false;
-            height_modified = false;
-        }
-
-        state.seed = generate_board(state, s, ui_black_chance, ui_observer_chance);
-        state.redo_stack.clear();
-        state.undo_stack.clear();
-        state.solved = false;
+        width_modified = false;
+        height_modified = false;
 
         // After generation, if we randomized, keep the ui in sync; if user had modified, keep that state
         if (!seed_modified && !seed_frozen) { ui_seed = state.seed; }
         seed_modified = false;
     }
 
+    if (state.difficulty >= 0.0f) { ImGui::TextDisabled("Difficulty: %.2f", state.difficulty); }
+    if (state.band_missed) {
+        ImGui::TextDisabled(ICON_FA_TRIANGLE_EXCLAMATION "Outside the target band");
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("No candidate could be steered into the band, this board may need "
+                              "guessing");
+        }
+    }
+
+    ImGui::Spacing();
+    ImGui::Spacing();
+
+    // ==================== PACK ====================
+    if (state.pack) {
+        render_section_header("Pack");
+
+        size_t count = state.pack->records.size();
+        ImGui::Text("Puzzle %zu of %zu", state.pack_index + 1, count);
+
+        float nav_width =
+            (ImGui::GetContentRegionAvail().x - ImGui::GetStyle().ItemSpacing.x) * 0.5f;
+        size_t target = state.pack_index;
+
+        if (state.pack_index == 0) ImGui::BeginDisabled();
+        if (ImGui::Button(ICON_FA_CHEVRON_LEFT "Previous", ImVec2(nav_width, 0))) { target--; }
+        if (state.pack_index == 0) ImGui::EndDisabled();
+
+        ImGui::SameLine();
+
+        if (state.pack_index + 1 >= count) ImGui::BeginDisabled();
+        if (ImGui::Button(ICON_FA_CHEVRON_RIGHT "Next", ImVec2(nav_width, 0))) { target++; }
+        if (state.pack_index + 1 >= count) ImGui::EndDisabled();
+
+        // resynced only when the state moves, so a half typed index is not overwritten
+        static int ui_pack_index = 1;
+        static size_t ui_pack_synced = SIZE_MAX;
+        if (ui_pack_synced != state.pack_index) {
+            ui_pack_synced = state.pack_index;
+            ui_pack_index = (int)state.pack_index + 1;
+        }
+        ImGui::SetNextItemWidth(-1);
+        if (ImGui::InputInt("##pack_index", &ui_pack_index, 0, 0,
+                ImGuiInputTextFlags_EnterReturnsTrue)) {
+            target = (size_t)std::clamp(ui_pack_index, 1, (int)count) - 1;
+        }
+
+        if (target != state.pack_index) {
+            endless_destroy(state);
+            auto err = open_pack_puzzle(state, target);
+            if (err != pack_error::OK) {
+                ImGui::InsertNotification({ImGuiToastType::Error,
+                    4000,
+                    "Failed to open puzzle %zu: %s",
+                    target + 1,
+                    get_pack_error_message(err)});
+            }
+        }
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+    }
+
+    // ==================== ENDLESS ====================
+    render_section_header("Endless");
+
+    if (!state.endless) {
+        if (ImGui::Button(ICON_FA_MAP "Start endless board", ImVec2(-1, 0))) {
+            // the board stops being a pack puzzle, its navigation would replace the window
+            delete state.pack;
+            state.pack = nullptr;
+            state.pack_index = 0;
+
+            state.endless = endless_create(ui_seed,
+                ui_black_chance,
+                ui_observer_chance,
+                (size_t)width,
+                (size_t)height);
+            endless_move(state, 0, 0);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("An unbounded board played through a window the size of the board");
+        }
+    } else {
+        endless_world& w = *state.endless;
+        ImGui::Text("Window at %d, %d", w.x, w.y);
+
+        float nav_width =
+            (ImGui::GetContentRegionAvail().x - ImGui::GetStyle().ItemSpacing.x * 3) * 0.25f;
+        int32_t x = w.x, y = w.y;
+
+        if (ImGui::Button(ICON_FA_ARROW_LEFT "##endless_left", ImVec2(nav_width, 0))) x--;
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_ARROW_UP "##endless_up", ImVec2(nav_width, 0))) y--;
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_ARROW_DOWN "##endless_down", ImVec2(nav_width, 0))) y++;
+        ImGui::SameLine();
+        if (ImGui::Button(ICON_FA_ARROW_RIGHT "##endless_right", ImVec2(nav_width, 0))) x++;
+
+        if (x != w.x || y != w.y) endless_move(state, x, y);
+
+        if (ImGui::Button("Leave endless board", ImVec2(-1, 0))) endless_destroy(state);
+    }
+
     ImGui::Spacing();
     ImGui::Spacing();
 
@@ -339,6 +540,24 @@ void board_controls(ctx_t* ctx) {
         state.needs_dock_rebuild = true;
     }
     ImGui::Checkbox("Auto Surround", &state.auto_surround);
+
+    ImGui::Checkbox("Idle when still", &ctx->idle_when_still);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Stops redrawing while nothing moves, saves battery");
+    }
+
+    ImGui::Checkbox("CPU board raster", &ctx->raster->enabled);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Draws the board on the cpu into one texture, meant for the software "
+                          "renderer");
+    }
+#if !defined(NDEBUG) || defined(__ANDROID__)
+    ImGui::Checkbox("Time board drawing", &ctx->time_board);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Flushes the renderer after the board and shows the time in the debug "
+                          "overlay, slows the gpu renderers");
+    }
+#endif
     ImGui::Checkbox("Custom Cursor", &state.custom_cursor);
 
     ImGui::Spacing();
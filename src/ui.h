@@ -5,5 +5,6 @@
 #include "common.h"
 
 void board_controls(ctx_t* ctx);
+void handle_ui_event(ctx_t* ctx, SDL_Event* event);
 
 #endif /* UI_H */
@@ -0,0 +1,81 @@
+#include "zobrist.h"
+#include <bit>
+#include "rng.h"
+
+// "kuromasu", changing it changes every stored hash
+static const counter_rng zobrist_rng(0x6b75726f6d617375ull);
+
+// counters within RNG_STREAM_ZOBRIST: cells take the low range, observers and sizes get a tag bit
+constexpr uint64_t ZOBRIST_OBSERVER_TAG = 1ull << 47;
+constexpr uint64_t ZOBRIST_DIMS_TAG = 1ull << 46;
+
+uint64_t zobrist_cell(size_t index, cell::type_t type) {
+    if (type == cell::blank) return 0;
+    return zobrist_rng.u64(RNG_STREAM_ZOBRIST, (uint64_t)index * 2 + (type == cell::white));
+}
+
+uint64_t zobrist_observer(size_t index, int value) {
+    uint64_t counter = ZOBRIST_OBSERVER_TAG | ((uint64_t)index << 16) | (uint16_t)value;
+    return zobrist_rng.u64(RNG_STREAM_ZOBRIST, counter);
+}
+
+uint64_t zobrist_dims(size_t width, size_t height) {
+    uint64_t w = width & 0x7fffff;
+    uint64_t h = height & 0x7fffff;
+    uint64_t counter = ZOBRIST_DIMS_TAG | (w << 23) | h;
+    return zobrist_rng.u64(RNG_STREAM_ZOBRIST, counter);
+}
+
+uint64_t layout_hash(size_t width, size_t height, const observer_table& observers) {
+    uint64_t h = zobrist_dims(width, height);
+    for (auto& o : observers) {
+        h ^= zobrist_observer(o.pos.y * width + o.pos.x, o.value);
+    }
+    return h;
+}
+
+uint64_t board_hash(kuromasu_grid& g, const observer_table& observers) {
+    zone_scoped_n("board hash");
+
+    uint64_t h = layout_hash(g.width, g.height, observers);
+    for (size_t y = 0; y < g.height; y++) {
+        for (size_t x = 0; x < g.width; x++) {
+            h ^= zobrist_cell(y * g.width + x, g.at(x, y).type);
+        }
+    }
+    return h;
+}
+
+void tt_init(transposition_table& tt, size_t capacity) {
+    tt.slots.assign(std::bit_ceil(std::max(capacity, (size_t)1)), {});
+    tt.hits = 0;
+    tt.misses = 0;
+}
+
+void tt_clear(transposition_table& tt) { tt_init(tt, tt.slots.size()); }
+
+// the low bits of a zobrist hash are as good as any, and a key of 0 is folded onto 1 so it does
+// not read as an empty slot
+static uint64_t tt_key(uint64_t key) { return key ? key : 1; }
+
+bool tt_find(transposition_table& tt, uint64_t key, uint32_t* value) {
+    if (tt.slots.empty()) return false;
+
+    key = tt_key(key);
+    auto& e = tt.slots[key & (tt.slots.size() - 1)];
+    if (e.key != key) {
+        tt.misses++;
+        return false;
+    }
+
+    tt.hits++;
+    if (value) *value = e.value;
+    return true;
+}
+
+void tt_store(transposition_table& tt, uint64_t key, uint32_t value) {
+    if (tt.slots.empty()) return;
+
+    key = tt_key(key);
+    tt.slots[key & (tt.slots.size() - 1)] = {.key = key, .value = value};
+}
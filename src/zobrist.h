@@ -0,0 +1,51 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "common.h"
+
+// 64 bit zobrist hashes of boards. every (cell, type), (observer, value) and board size has its
+// own key and a hash is the xor of the keys present, so a single cell_change updates it with two
+// xors. keys come from the counter rng under a fixed key, they are the same in every build and on
+// every platform. blank cells have no key, a board with nothing filled in hashes to its layout
+
+uint64_t zobrist_cell(size_t index, cell::type_t type);
+uint64_t zobrist_observer(size_t index, int value);
+uint64_t zobrist_dims(size_t width, size_t height);
+
+inline void zobrist_update(uint64_t& hash,
+    size_t index,
+    cell::type_t old_type,
+    cell::type_t new_type) {
+    hash ^= zobrist_cell(index, old_type) ^ zobrist_cell(index, new_type);
+}
+
+// size and observers only, what tells one puzzle apart from another
+uint64_t layout_hash(size_t width, size_t height, const observer_table& observers);
+inline uint64_t layout_hash(const puzzle_t& p) {
+    return layout_hash(p.params.width, p.params.height, p.observers);
+}
+
+// layout plus every filled in cell
+uint64_t board_hash(kuromasu_grid& g, const observer_table& observers);
+
+// fixed size hash map from a zobrist hash to a small result. one entry per slot and a newer store
+// always replaces what was there, so it never grows and a lookup is a single probe. a miss only
+// means the result has to be computed again
+struct transposition_entry {
+    uint64_t key = 0;  // 0 marks an empty slot
+    uint32_t value = 0;
+};
+
+struct transposition_table {
+    std::vector<transposition_entry> slots;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// rounds capacity up to a power of two
+void tt_init(transposition_table& tt, size_t capacity);
+void tt_clear(transposition_table& tt);
+bool tt_find(transposition_table& tt, uint64_t key, uint32_t* value);
+void tt_store(transposition_table& tt, uint64_t key, uint32_t value);
+
+#endif /* ZOBRIST_H */
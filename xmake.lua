@@ -16,6 +16,12 @@ package("ktl")
     end)
 package_end()
 
+option("alloc_tracking")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Count heap allocations per frame and per profiler zone")
+option_end()
+
 add_requires("imgui v1.92.5-docking", {configs = {freetype = true}})
 add_requires("tracy", {configs = {on_demand = true}})
 add_requires("ktl 99ca814", "libsdl3_ttf", "libsdl3_image", "libsdl3", "nlohmann_json")
@@ -53,6 +59,10 @@ target("kuromasu")
         add_defines("TRACY_ENABLE", "TRACY_ON_DEMAND")
     end
 
+    if has_config("alloc_tracking") then
+        add_defines("KUROMASU_ALLOC_TRACKING")
+    end
+
     if is_plat("android") then
         add_defines("__ANDROID__", "ASSET_DIR=\"\"")
         add_syslinks("android", "log")